@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "bake.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "utils.hpp"
+
+namespace rlo
+{
+namespace
+{
+// Hexadecimal, so the compiled-in value is exactly the float the config was parsed to
+std::string float_literal(float value)
+{
+    if (value == std::numeric_limits<float>::infinity())
+    {
+        return "std::numeric_limits<float>::infinity()";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%af", static_cast<double>(value));
+    return buffer;
+}
+
+// Eight to a line, indented to sit inside the braces of an array
+template <class T, class Format>
+std::string list(const std::vector<T> &values, Format &&format, const std::string &indent)
+{
+    std::string result;
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+        result += i % 8 == 0 ? "\n" + indent : " ";
+        result += format(values[i]);
+        result += i + 1 < values.size() ? "," : "";
+    }
+    return result + "\n";
+}
+}
+
+std::string bake_config(const std::vector<RoomConfig> &config, const std::string &source)
+{
+    const auto unsigned_literal = [](unsigned int value) { return std::to_string(value) + "u"; };
+    const auto bool_literal = [](bool value) { return std::string(value ? "true" : "false"); };
+
+    std::vector<unsigned int> counts;
+    std::vector<unsigned int> minimum_sizes;
+    std::vector<float> size_scalings;
+    // Matches the costs EvaluationTables gives each tile
+    std::vector<float> movement_costs(256, 1.f);
+    for (std::size_t type = 0; type < config.size(); type++)
+    {
+        counts.push_back(config[type].count);
+        minimum_sizes.push_back(config[type].minimum_size);
+        size_scalings.push_back(config[type].size_scaling);
+        if (type < floor)
+        {
+            movement_costs[type] = config[type].movement_cost;
+        }
+    }
+    movement_costs[floor] = 1.f;
+    movement_costs[door] = door_move_cost;
+    movement_costs[wall] = std::numeric_limits<float>::infinity();
+
+    std::ostringstream header;
+    header << "// Generated by rlo_bake from " << source
+           << ". Change the config and rebuild rather than editing this.\n"
+           << "#pragma once\n\n"
+           << "#include <array>\n#include <cstddef>\n#include <cstdint>\n#include <limits>\n\n"
+           << "namespace rlo\n{\nnamespace baked\n{\n"
+           << "// config_fingerprint() of the config, with a size of 0\n"
+           << "constexpr std::uint64_t fingerprint = " << config_fingerprint(config, 0)
+           << "ull;\n"
+           << "constexpr std::size_t room_types = " << config.size() << ";\n\n"
+           << "constexpr std::array<unsigned int, room_types> counts{"
+           << list(counts, unsigned_literal, "    ") << "};\n"
+           << "constexpr std::array<unsigned int, room_types> minimum_sizes{"
+           << list(minimum_sizes, unsigned_literal, "    ") << "};\n"
+           << "constexpr std::array<float, room_types> size_scalings{"
+           << list(size_scalings, float_literal, "    ") << "};\n"
+           << "constexpr std::array<float, 256> movement_costs{"
+           << list(movement_costs, float_literal, "    ") << "};\n\n";
+
+    // Weights on types the config doesn't have can never apply, so they're left out
+    header << "// Indexed by room type, then target type\n"
+           << "constexpr std::array<std::array<bool, room_types>, room_types> has_weight{{";
+    for (const auto &room : config)
+    {
+        std::vector<bool> row(config.size(), false);
+        for (const auto &[target, weight] : room.weights)
+        {
+            if (target < config.size())
+            {
+                row[target] = true;
+            }
+        }
+        header << "\n    {{" << list(row, bool_literal, "        ") << "    }},";
+    }
+    header << "\n}};\n"
+           << "constexpr std::array<std::array<float, room_types>, room_types> weights{{";
+    for (const auto &room : config)
+    {
+        std::vector<float> row(config.size(), 0.f);
+        for (const auto &[target, weight] : room.weights)
+        {
+            if (target < config.size())
+            {
+                row[target] = weight;
+            }
+        }
+        header << "\n    {{" << list(row, float_literal, "        ") << "    }},";
+    }
+    header << "\n}};\n}\n}\n";
+    return header.str();
+}
+
+TEST_CASE("bake_config()")
+{
+    const auto config = read_config_from_string(R"(- name: bedroom
+  count: 10
+  minimum_size: 20
+  size_scaling: 0.1
+  movement_cost: 10
+  color: [255, 255, 25]
+  attributes: []
+  weights:
+    stockpile: 0.02
+- name: stockpile
+  count: 1
+  minimum_size: 100
+  size_scaling: 2
+  movement_cost: 2
+  attributes: []
+  color: [230, 25, 75]
+  weights: {})");
+    const auto header = bake_config(config, "test.yml");
+
+    CHECK(header.find("from test.yml") != std::string::npos);
+    CHECK(header.find("room_types = 2;") != std::string::npos);
+    CHECK(header.find("fingerprint = " + std::to_string(config_fingerprint(config, 0)) +
+                      "ull;") != std::string::npos);
+    CHECK(header.find("counts{\n    10u, 1u\n}") != std::string::npos);
+    CHECK(header.find("{{\n        false, true\n    }},\n    {{\n        false, false\n    }},") !=
+          std::string::npos);
+    // 0.1 can't be written exactly in decimal, but its float can in hexadecimal
+    CHECK(std::strtof(float_literal(0.1f).c_str(), nullptr) == 0.1f);
+    CHECK(float_literal(std::numeric_limits<float>::infinity()) ==
+          "std::numeric_limits<float>::infinity()");
+}
+}
\ No newline at end of file
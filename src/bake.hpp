@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+
+namespace rlo
+{
+// The source of a header of constexpr tables holding everything evaluate() reads from the
+// config, for builds with RLO_BAKED_CONFIG to specialize it on. `source` only goes in a comment.
+std::string bake_config(const std::vector<RoomConfig> &config, const std::string &source);
+}
\ No newline at end of file
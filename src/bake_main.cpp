@@ -0,0 +1,25 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "bake.hpp"
+#include "config.hpp"
+
+// Run by the build when RLO_BAKED_CONFIG is set, turning that config into baked_config.hpp
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: rlo_bake <config.yml> <baked_config.hpp>\n";
+        return 1;
+    }
+    const auto config = rlo::read_config_from_file(argv[1]);
+    std::ofstream header(argv[2]);
+    header << rlo::bake_config(config, std::filesystem::path(argv[1]).filename().string());
+    if (!header)
+    {
+        std::cerr << "Couldn't write " << argv[2] << "\n";
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "batch.hpp"
+#include "config.hpp"
+#include "frozen.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace rlo
+{
+struct JobSummary
+{
+    bool succeeded = false;
+    float score = 0;
+    std::size_t evaluations = 0;
+    double seconds = 0;
+    std::string error;
+};
+
+bool is_config_file(const fs::path &path)
+{
+    return fs::is_regular_file(path) &&
+           (path.extension() == ".yml" || path.extension() == ".yaml");
+}
+
+std::vector<std::string> read_manifest(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Couldn't open manifest: " + path);
+    }
+    const auto base = fs::path(path).parent_path();
+
+    std::vector<std::string> config_paths;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        const auto entry = base / line;
+        if (fs::is_directory(entry))
+        {
+            std::vector<std::string> directory_configs;
+            for (const auto &child : fs::directory_iterator(entry))
+            {
+                if (is_config_file(child.path()))
+                {
+                    directory_configs.push_back(child.path().string());
+                }
+            }
+            std::sort(directory_configs.begin(), directory_configs.end());
+            config_paths.insert(config_paths.end(), directory_configs.begin(),
+                                directory_configs.end());
+        }
+        else
+        {
+            config_paths.push_back(entry.string());
+        }
+    }
+    return config_paths;
+}
+
+std::vector<BatchJob> plan_batch(const std::vector<std::string> &config_paths,
+                                 const std::string &output_root)
+{
+    // A numbered name can be some other config's own name, so every name handed out is kept
+    std::unordered_set<std::string> used_names;
+    std::unordered_map<std::string, unsigned int> name_counts;
+    std::vector<BatchJob> jobs;
+    for (const auto &config_path : config_paths)
+    {
+        const auto stem = fs::path(config_path).stem().string();
+        auto name = stem;
+        auto &count = name_counts[stem];
+        while (!used_names.insert(name).second)
+        {
+            name = stem + "_" + std::to_string(++count + 1);
+        }
+        jobs.push_back({config_path, (fs::path(output_root) / name).string()});
+    }
+    return jobs;
+}
+
+void print_summary(std::ostream &stream, const std::vector<BatchJob> &jobs,
+                   const std::vector<JobSummary> &summaries, bool aligned)
+{
+    const auto column = [&](int width) -> std::ostream & {
+        return aligned ? stream << std::setw(width) : stream;
+    };
+    const char *separator = aligned ? " " : "\t";
+    std::size_t config_width = 6;
+    for (const auto &job : jobs)
+    {
+        config_width = std::max(config_width, job.config_path.size());
+    }
+
+    stream << std::left;
+    column(static_cast<int>(config_width)) << "config" << separator;
+    stream << std::right;
+    column(16) << "score" << separator;
+    column(12) << "evaluations" << separator;
+    column(10) << "seconds" << separator << "output\n";
+    for (std::size_t i = 0; i < jobs.size(); i++)
+    {
+        const auto &summary = summaries[i];
+        stream << std::left;
+        column(static_cast<int>(config_width)) << jobs[i].config_path << separator;
+        stream << std::right;
+        if (summary.succeeded)
+        {
+            column(16) << std::to_string(summary.score) << separator;
+            column(12) << summary.evaluations << separator;
+            column(10) << std::to_string(summary.seconds) << separator;
+            stream << jobs[i].output_directory << "\n";
+        }
+        else
+        {
+            stream << "failed: " << summary.error << "\n";
+        }
+    }
+}
+
+template <class Genome>
+void run_batch(const std::string &manifest, const OptimizationOptions &options,
+               const BatchOptions &batch)
+{
+    auto &pool = ThreadPool::shared();
+    const auto jobs = plan_batch(read_manifest(manifest), batch.output_directory);
+    std::vector<JobSummary> summaries(jobs.size());
+    std::mutex print_mutex;
+
+    const auto run_job = [&](std::size_t i) {
+        const auto &job = jobs[i];
+        auto &summary = summaries[i];
+        const auto start_time = std::chrono::steady_clock::now();
+        try
+        {
+            const auto config = read_config_from_file(job.config_path);
+            fs::create_directories(job.output_directory);
+
+            auto job_options = options;
+            job_options.output_directory = job.output_directory;
+            job_options.report_progress = false;
+            if (!batch.frozen_path.empty())
+            {
+                job_options.frozen = std::make_shared<FrozenMask>(
+                    read_frozen_mask(batch.frozen_path, map_size, config));
+            }
+            const auto result = run_optimization<Genome>(config, job_options);
+
+            summary.succeeded = true;
+            summary.score = result.score;
+            summary.evaluations = result.evaluations;
+        }
+        catch (const std::exception &error)
+        {
+            summary.error = error.what();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        summary.seconds = elapsed.count();
+
+        std::lock_guard<std::mutex> lock(print_mutex);
+        std::cout << "Finished " << job.config_path << "\n";
+    };
+    // Jobs only borrow idle workers for their chains, so running several at once leaves each
+    // with fewer threads rather than oversubscribing the machine
+    const auto parallel_jobs = batch.parallel_jobs == 0 ? pool.size() + 1 : batch.parallel_jobs;
+    pool.parallel_for(0, jobs.size(), run_job, parallel_jobs);
+
+    print_summary(std::cout, jobs, summaries, true);
+    fs::create_directories(batch.output_directory);
+    std::ofstream summary_file(fs::path(batch.output_directory) / "summary.tsv");
+    print_summary(summary_file, jobs, summaries, false);
+}
+
+template void run_batch<std::vector<Node>>(const std::string &manifest,
+                                           const OptimizationOptions &options,
+                                           const BatchOptions &batch);
+template void run_batch<std::vector<Room>>(const std::string &manifest,
+                                           const OptimizationOptions &options,
+                                           const BatchOptions &batch);
+
+TEST_CASE("Batches")
+{
+    SUBCASE("Manifests expand directories and skip comments")
+    {
+        const auto root = fs::temp_directory_path() / "rlo_manifest_test";
+        fs::remove_all(root);
+        fs::create_directories(root / "colonies");
+        std::ofstream(root / "colonies" / "b.yml").put('\n');
+        std::ofstream(root / "colonies" / "a.yaml").put('\n');
+        std::ofstream(root / "colonies" / "notes.txt").put('\n');
+        std::ofstream(root / "manifest.txt") << "# nightly\n\nsingle.yml\n  colonies  \n";
+
+        const auto configs = read_manifest((root / "manifest.txt").string());
+
+        REQUIRE(configs.size() == 3);
+        CHECK(configs[0] == (root / "single.yml").string());
+        CHECK(configs[1] == (root / "colonies" / "a.yaml").string());
+        CHECK(configs[2] == (root / "colonies" / "b.yml").string());
+        fs::remove_all(root);
+    }
+
+    SUBCASE("Configs sharing a name get separate output directories")
+    {
+        const auto jobs = plan_batch({"a/colony.yml", "b/colony.yml", "other.yaml"}, "out");
+
+        REQUIRE(jobs.size() == 3);
+        CHECK(jobs[0].output_directory == (fs::path("out") / "colony").string());
+        CHECK(jobs[1].output_directory == (fs::path("out") / "colony_2").string());
+        CHECK(jobs[2].output_directory == (fs::path("out") / "other").string());
+    }
+
+    SUBCASE("Numbered names skip over names configs already have")
+    {
+        const auto jobs = plan_batch(
+            {"a/colony.yml", "b/colony.yml", "c/colony_2.yml", "d/colony_3.yml", "e/colony.yml"},
+            "out");
+
+        REQUIRE(jobs.size() == 5);
+        CHECK(jobs[0].output_directory == (fs::path("out") / "colony").string());
+        CHECK(jobs[1].output_directory == (fs::path("out") / "colony_2").string());
+        CHECK(jobs[2].output_directory == (fs::path("out") / "colony_2_2").string());
+        CHECK(jobs[3].output_directory == (fs::path("out") / "colony_3").string());
+        CHECK(jobs[4].output_directory == (fs::path("out") / "colony_4").string());
+    }
+}
+}
\ No newline at end of file
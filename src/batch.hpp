@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "optimize.hpp"
+
+namespace rlo
+{
+struct BatchOptions
+{
+    // Each job writes its snapshots to its own subdirectory of this, and summary.tsv goes here
+    std::string output_directory = "batch";
+    // How many jobs run at once; 0 runs as many as the pool has threads for
+    unsigned int parallel_jobs = 0;
+    // When set, a mask every job keeps frozen. Each job reads it against its own config, so a
+    // mask using colours a config doesn't know only fails that job.
+    std::string frozen_path;
+};
+
+struct BatchJob
+{
+    std::string config_path;
+    std::string output_directory;
+};
+
+// Reads a manifest with one config file or directory per line, relative to the manifest's own
+// directory. A directory stands for every .yml and .yaml file directly inside it, in name order.
+// Blank lines and lines starting with # are skipped.
+std::vector<std::string> read_manifest(const std::string &path);
+
+// Names each job's output directory after its config file, adding the lowest number that makes
+// it unique when the name is already taken
+std::vector<BatchJob> plan_batch(const std::vector<std::string> &config_paths,
+                                 const std::string &output_root);
+
+// Optimizes every config in the manifest, several at once on the shared pool, then prints a
+// summary table and saves it as summary.tsv. A job that fails is reported in the summary instead
+// of stopping the batch. Instantiated for both genomes.
+template <class Genome>
+void run_batch(const std::string &manifest, const OptimizationOptions &options,
+               const BatchOptions &batch = {});
+}
\ No newline at end of file
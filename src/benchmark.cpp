@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+
+namespace rlo
+{
+template <class Function>
+double time_per_sample(unsigned int samples, Function &&function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < samples; i++)
+    {
+        function(i);
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / samples;
+}
+
+template <class Genome>
+void benchmark_genome(const std::vector<RoomConfig> &config, unsigned int samples)
+{
+    using Traits = GenomeTraits<Genome>;
+    Rng rng(0);
+    const auto selector = Traits::make_selector(false);
+
+    std::vector<Genome> genomes;
+    const auto generate = time_per_sample(
+        samples, [&](unsigned int) { genomes.push_back(Traits::generate(config, rng)); });
+    const auto permute = time_per_sample(samples, [&](unsigned int i) {
+        genomes[i] = Traits::permute(genomes[i], config, rng, selector.select(rng));
+    });
+    std::vector<Map> maps;
+    maps.reserve(samples);
+    const auto rasterize = time_per_sample(
+        samples, [&](unsigned int i) { maps.push_back(Traits::rasterize(genomes[i])); });
+    float total_score = 0;
+    const auto evaluation =
+        time_per_sample(samples, [&](unsigned int i) { total_score += evaluate(maps[i], config); });
+
+    std::cout << Traits::name << ":\n";
+    std::cout << "  generate: " << std::to_string(generate) << "us\n";
+    std::cout << "  permute: " << std::to_string(permute) << "us\n";
+    std::cout << "  rasterize: " << std::to_string(rasterize) << "us\n";
+    std::cout << "  evaluate: " << std::to_string(evaluation) << "us\n";
+    std::cout << "  mean score: " << std::to_string(total_score / static_cast<float>(samples))
+              << "\n";
+}
+
+// Compares the draws the mutation loop makes against std::mt19937 with a distribution object
+// built per draw, which is how they were made before Rng
+void benchmark_random_numbers(unsigned int draws)
+{
+    std::mt19937 mt19937(0);
+    Rng rng(0);
+    double sink = 0;
+    const auto mt19937_uniform = time_per_sample(draws, [&](unsigned int) {
+        sink += std::uniform_int_distribution<unsigned int>(0, 99)(mt19937);
+    });
+    const auto rng_uniform = time_per_sample(draws, [&](unsigned int) { sink += rng.below(100); });
+    const auto mt19937_normal = time_per_sample(draws, [&](unsigned int) {
+        sink += std::normal_distribution<float>(0, 5)(mt19937);
+    });
+    const auto rng_normal = time_per_sample(draws, [&](unsigned int) { sink += rng.normal(0, 5); });
+
+    std::cout << "random numbers (ns per draw):\n";
+    std::cout << "  uniform: " << std::to_string(mt19937_uniform * 1000.) << " mt19937, "
+              << std::to_string(rng_uniform * 1000.) << " xoshiro256**\n";
+    std::cout << "  normal: " << std::to_string(mt19937_normal * 1000.) << " mt19937, "
+              << std::to_string(rng_normal * 1000.) << " xoshiro256**\n";
+    // Printing the sum keeps the draws from being optimised away
+    std::cout << "  checksum: " << std::to_string(sink) << "\n";
+}
+
+void run_benchmark(const std::vector<RoomConfig> &config, unsigned int samples)
+{
+    samples = std::max(samples, 1u);
+    std::cout << "Mean time per layout over " << std::to_string(samples) << " samples\n";
+    benchmark_genome<std::vector<Node>>(config, samples);
+    benchmark_genome<std::vector<Room>>(config, samples);
+    benchmark_random_numbers(samples * 10000);
+}
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include "config.hpp"
+
+namespace rlo
+{
+// Times generating, rasterizing, mutating and evaluating `samples` random layouts of each genome
+// and prints the mean cost of each stage
+void run_benchmark(const std::vector<RoomConfig> &config, unsigned int samples = 200);
+}
\ No newline at end of file
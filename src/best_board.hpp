@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace rlo
+{
+// Lock-free holder for the best solution found so far, shared between optimizer chains.
+//
+// Every published entry is immutable and stays alive until the board is destroyed, so readers
+// can hold on to a snapshot without any coordination with writers. Entries are only published
+// when they beat the current best, which keeps the retained history small.
+template <class Value>
+class BestBoard
+{
+  public:
+    struct Entry
+    {
+        Value value;
+        float score;
+        std::uint64_t version;
+        const Entry *previous;
+    };
+
+  private:
+    std::atomic<const Entry *> m_best;
+
+  public:
+    BestBoard() : m_best(nullptr) {}
+
+    BestBoard(const Value &value, float score) : m_best(new Entry{value, score, 1, nullptr}) {}
+
+    ~BestBoard()
+    {
+        const auto *entry = m_best.load();
+        while (entry != nullptr)
+        {
+            const auto *previous = entry->previous;
+            delete entry;
+            entry = previous;
+        }
+    }
+
+    BestBoard(const BestBoard &) = delete;
+    BestBoard &operator=(const BestBoard &) = delete;
+
+    // Returns true if the value was better than the current best and has replaced it
+    bool publish(const Value &value, float score)
+    {
+        const auto *current = m_best.load(std::memory_order_acquire);
+        if (current != nullptr && current->score >= score)
+        {
+            return false;
+        }
+
+        auto *entry = new Entry{value, score, 0, nullptr};
+        while (true)
+        {
+            if (current != nullptr && current->score >= score)
+            {
+                delete entry;
+                return false;
+            }
+            entry->previous = current;
+            entry->version = current == nullptr ? 1 : current->version + 1;
+            if (m_best.compare_exchange_weak(current, entry, std::memory_order_acq_rel,
+                                             std::memory_order_acquire))
+            {
+                return true;
+            }
+        }
+    }
+
+    // The returned entry remains valid for the lifetime of the board, or nullptr if nothing has
+    // been published yet
+    inline const Entry *snapshot() const { return m_best.load(std::memory_order_acquire); }
+
+    // Changes every time a better value is published
+    inline std::uint64_t version() const
+    {
+        const auto *entry = snapshot();
+        return entry == nullptr ? 0 : entry->version;
+    }
+};
+}
\ No newline at end of file
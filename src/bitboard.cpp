@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "bitboard.hpp"
+
+namespace rlo
+{
+Bitboard::Bitboard(unsigned int size)
+{
+    m_size = size;
+    m_words_per_row = (size + 63) / 64;
+    m_words = std::vector<std::uint64_t>(m_words_per_row * m_size, 0);
+}
+
+void Bitboard::clear_padding()
+{
+    if (m_size % 64 == 0)
+    {
+        return;
+    }
+    const std::uint64_t last_word_mask = (std::uint64_t{1} << (m_size % 64)) - 1;
+    for (unsigned int y = 0; y < m_size; y++)
+    {
+        m_words[y * m_words_per_row + m_words_per_row - 1] &= last_word_mask;
+    }
+}
+
+Bitboard Bitboard::flood_fill(unsigned int x, unsigned int y) const
+{
+    Bitboard result(m_size);
+    if (x >= m_size || y >= m_size || !get(x, y))
+    {
+        return result;
+    }
+    result.set(x, y);
+
+    // Spreads a single row along the runs of set bits in the mask until it stops growing
+    const auto spread_row = [&](unsigned int row) {
+        std::uint64_t *current = &result.m_words[row * m_words_per_row];
+        const std::uint64_t *mask = &m_words[row * m_words_per_row];
+        bool spreading = true;
+        while (spreading)
+        {
+            spreading = false;
+            for (unsigned int w = 0; w < m_words_per_row; w++)
+            {
+                std::uint64_t grown = current[w] | (current[w] << 1) | (current[w] >> 1);
+                if (w > 0)
+                {
+                    grown |= current[w - 1] >> 63;
+                }
+                if (w + 1 < m_words_per_row)
+                {
+                    grown |= current[w + 1] << 63;
+                }
+                grown &= mask[w];
+                if (grown != current[w])
+                {
+                    current[w] = grown;
+                    spreading = true;
+                }
+            }
+        }
+    };
+
+    spread_row(y);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        // Alternating downward and upward sweeps let vertical growth cross the whole board in
+        // a single pass
+        for (unsigned int sweep = 0; sweep < 2; sweep++)
+        {
+            for (unsigned int i = 0; i < m_size; i++)
+            {
+                const unsigned int row = sweep == 0 ? i : m_size - 1 - i;
+                bool row_changed = false;
+                for (unsigned int w = 0; w < m_words_per_row; w++)
+                {
+                    const auto index = row * m_words_per_row + w;
+                    std::uint64_t grown = result.m_words[index];
+                    if (row > 0)
+                    {
+                        grown |= result.m_words[index - m_words_per_row];
+                    }
+                    if (row + 1 < m_size)
+                    {
+                        grown |= result.m_words[index + m_words_per_row];
+                    }
+                    grown &= m_words[index];
+                    if (grown != result.m_words[index])
+                    {
+                        result.m_words[index] = grown;
+                        row_changed = true;
+                    }
+                }
+                if (row_changed)
+                {
+                    spread_row(row);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+bool Bitboard::any() const
+{
+    for (const auto word : m_words)
+    {
+        if (word != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t Bitboard::count() const
+{
+    std::size_t total = 0;
+    for (const auto word : m_words)
+    {
+        total += static_cast<std::size_t>(__builtin_popcountll(word));
+    }
+    return total;
+}
+
+bool Bitboard::intersects(const Bitboard &other) const
+{
+    for (std::size_t i = 0; i < m_words.size(); i++)
+    {
+        if ((m_words[i] & other.m_words[i]) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Bitboard Bitboard::operator~() const
+{
+    Bitboard result(*this);
+    for (auto &word : result.m_words)
+    {
+        word = ~word;
+    }
+    result.clear_padding();
+    return result;
+}
+
+Bitboard &Bitboard::operator&=(const Bitboard &other)
+{
+    for (std::size_t i = 0; i < m_words.size(); i++)
+    {
+        m_words[i] &= other.m_words[i];
+    }
+    return *this;
+}
+
+Bitboard &Bitboard::operator|=(const Bitboard &other)
+{
+    for (std::size_t i = 0; i < m_words.size(); i++)
+    {
+        m_words[i] |= other.m_words[i];
+    }
+    return *this;
+}
+
+bool Bitboard::operator==(const Bitboard &other) const
+{
+    return m_size == other.m_size && m_words == other.m_words;
+}
+
+TEST_CASE("Bitboard")
+{
+    SUBCASE("Starts empty")
+    {
+        const Bitboard board(70);
+
+        CHECK(!board.any());
+        CHECK(board.count() == 0);
+        CHECK(board.words_per_row() == 2);
+    }
+
+    SUBCASE("Inverting doesn't set bits past the edge of the board")
+    {
+        const auto board = ~Bitboard(70);
+
+        CHECK(board.count() == 70 * 70);
+    }
+
+    SUBCASE("set() and reset() toggle single tiles")
+    {
+        Bitboard board(70);
+        board.set(65, 3);
+
+        CHECK(board.get(65, 3));
+        CHECK(board.count() == 1);
+
+        board.reset(65, 3);
+
+        CHECK(!board.any());
+    }
+
+    SUBCASE("flood_fill()")
+    {
+        // A wall along x == 66 splits the board, with a gap at y == 69, and the seed has to
+        // cross a word boundary to reach it
+        auto passable = ~Bitboard(70);
+        for (unsigned int y = 0; y < 69; y++)
+        {
+            passable.reset(66, y);
+        }
+
+        SUBCASE("Fills everything reachable through the gap")
+        {
+            const auto component = passable.flood_fill(0, 0);
+
+            CHECK(component == passable);
+        }
+
+        SUBCASE("Stops at a closed wall")
+        {
+            passable.reset(66, 69);
+            const auto component = passable.flood_fill(0, 0);
+
+            CHECK(component.count() == 66 * 70);
+            CHECK(component.get(65, 69));
+            CHECK(!component.get(67, 0));
+            CHECK(!component.intersects(passable.flood_fill(69, 0)));
+        }
+
+        SUBCASE("Is empty when started outside the mask")
+        {
+            CHECK(!passable.flood_fill(66, 0).any());
+        }
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace rlo
+{
+class Bitboard
+{
+  private:
+    unsigned int m_size;
+    unsigned int m_words_per_row;
+    std::vector<std::uint64_t> m_words;
+
+    void clear_padding();
+
+  public:
+    explicit Bitboard(unsigned int size = 0);
+
+    // Returns the 4-connected component of this board that contains (x, y), expanding a whole
+    // row of words at a time. The result is empty if (x, y) is not set.
+    Bitboard flood_fill(unsigned int x, unsigned int y) const;
+
+    bool any() const;
+    std::size_t count() const;
+    bool intersects(const Bitboard &other) const;
+
+    Bitboard operator~() const;
+    Bitboard &operator&=(const Bitboard &other);
+    Bitboard &operator|=(const Bitboard &other);
+    bool operator==(const Bitboard &other) const;
+
+    inline bool get(unsigned int x, unsigned int y) const
+    {
+        return (m_words[y * m_words_per_row + x / 64] >> (x % 64)) & 1u;
+    }
+    inline void set(unsigned int x, unsigned int y)
+    {
+        m_words[y * m_words_per_row + x / 64] |= std::uint64_t{1} << (x % 64);
+    }
+    inline void reset(unsigned int x, unsigned int y)
+    {
+        m_words[y * m_words_per_row + x / 64] &= ~(std::uint64_t{1} << (x % 64));
+    }
+
+    inline unsigned int size() const { return m_size; }
+    inline unsigned int words_per_row() const { return m_words_per_row; }
+    inline const std::vector<std::uint64_t> &words() const { return m_words; }
+};
+}
\ No newline at end of file
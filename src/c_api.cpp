@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "rlo.h"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "optimizer.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+struct rlo_config
+{
+    std::vector<rlo::RoomConfig> config;
+};
+
+struct rlo_optimizer
+{
+    using Variant = std::variant<rlo::Optimizer<std::vector<rlo::Node>>,
+                                 rlo::Optimizer<std::vector<rlo::Room>>>;
+    Variant optimizer;
+};
+
+namespace
+{
+thread_local std::string last_error;
+
+// Throws unless the caller passed `pointer`, naming the argument in the message
+void require(const void *pointer, const char *name)
+{
+    if (pointer == nullptr)
+    {
+        throw std::invalid_argument(std::string("No ") + name + " given");
+    }
+}
+
+// Runs function(), turning any exception into `failure` plus a message for rlo_last_error()
+template <class Result, class Function>
+Result guarded(Result failure, Function &&function)
+{
+    try
+    {
+        last_error.clear();
+        return function();
+    }
+    catch (const std::exception &error)
+    {
+        last_error = error.what();
+    }
+    catch (...)
+    {
+        last_error = "Unknown error";
+    }
+    return failure;
+}
+}
+
+extern "C" {
+const char *rlo_last_error(void)
+{
+    return last_error.c_str();
+}
+
+unsigned int rlo_map_size(void)
+{
+    return rlo::map_size;
+}
+
+rlo_config *rlo_config_load(const char *path)
+{
+    return guarded<rlo_config *>(nullptr, [&] {
+        require(path, "path");
+        return new rlo_config{rlo::read_config_from_file(path)};
+    });
+}
+
+rlo_config *rlo_config_parse(const char *yaml)
+{
+    return guarded<rlo_config *>(nullptr, [&] {
+        require(yaml, "YAML");
+        return new rlo_config{rlo::read_config_from_string(yaml)};
+    });
+}
+
+void rlo_config_free(rlo_config *config)
+{
+    delete config;
+}
+
+int rlo_evaluate(const rlo_config *config, const unsigned char *tiles, unsigned int size,
+                 float *score)
+{
+    return guarded(-1, [&] {
+        require(config, "config");
+        require(tiles, "tiles");
+        require(score, "score");
+        rlo::check_tiles(tiles, std::size_t{size} * size, config->config);
+        const rlo::Map map(size, rlo::TileSpan{tiles, std::size_t{size} * size});
+        *score = rlo::evaluate(map, config->config);
+        return 0;
+    });
+}
+
+int rlo_evaluate_batch(const rlo_config *config, const unsigned char *tiles, size_t count,
+                       unsigned int size, float *scores)
+{
+    return guarded(-1, [&] {
+        const std::size_t tiles_per_map = std::size_t{size} * size;
+        require(config, "config");
+        if (count > 0)
+        {
+            require(tiles, "tiles");
+            require(scores, "scores");
+        }
+        rlo::check_tiles(tiles, count * tiles_per_map, config->config);
+        std::vector<rlo::Map> maps;
+        maps.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            maps.emplace_back(size, rlo::TileSpan{tiles + i * tiles_per_map, tiles_per_map});
+        }
+        auto &pool = rlo::ThreadPool::shared();
+        rlo::evaluate_batch(maps.data(), maps.size(), rlo::EvaluationTables(config->config),
+                            scores, {&pool, pool.size() + 1});
+        return 0;
+    });
+}
+
+rlo_optimizer *rlo_optimizer_create(const rlo_config *config, const char *genome,
+                                    unsigned int chains, unsigned int iterations,
+                                    unsigned int steps_per_iteration, uint64_t seed)
+{
+    return guarded<rlo_optimizer *>(nullptr, [&]() -> rlo_optimizer * {
+        require(config, "config");
+        require(genome, "genome");
+        rlo::OptimizationOptions options;
+        options.chains = chains;
+        options.iterations = iterations;
+        options.steps_per_iteration = steps_per_iteration;
+        options.seed = seed;
+        if (std::strcmp(genome, "rooms") == 0)
+        {
+            // Optimizers can't be moved, so they're built in place inside the variant
+            return new rlo_optimizer{rlo_optimizer::Variant(
+                std::in_place_type<rlo::Optimizer<std::vector<rlo::Room>>>, config->config,
+                options)};
+        }
+        if (std::strcmp(genome, "tree") == 0)
+        {
+            return new rlo_optimizer{rlo_optimizer::Variant(
+                std::in_place_type<rlo::Optimizer<std::vector<rlo::Node>>>, config->config,
+                options)};
+        }
+        throw std::runtime_error(std::string("Unknown genome: ") + genome);
+    });
+}
+
+int rlo_optimizer_step(rlo_optimizer *optimizer)
+{
+    return guarded(-1, [&] {
+        return std::visit([](auto &active) { return active.step() ? 1 : 0; },
+                          optimizer->optimizer);
+    });
+}
+
+double rlo_optimizer_progress(const rlo_optimizer *optimizer)
+{
+    return std::visit([](const auto &active) { return active.progress(); }, optimizer->optimizer);
+}
+
+float rlo_optimizer_best_score(const rlo_optimizer *optimizer)
+{
+    return std::visit([](const auto &active) { return active.best_score(); },
+                      optimizer->optimizer);
+}
+
+int rlo_optimizer_best_tiles(const rlo_optimizer *optimizer, unsigned char *tiles, size_t length)
+{
+    return guarded(-1, [&] {
+        const auto map =
+            std::visit([](const auto &active) { return active.best_map(); }, optimizer->optimizer);
+        const auto best = map.data();
+        if (length < best.size())
+        {
+            throw std::runtime_error("Tile buffer is smaller than the map");
+        }
+        std::copy(best.begin(), best.end(), tiles);
+        return 0;
+    });
+}
+
+void rlo_optimizer_free(rlo_optimizer *optimizer)
+{
+    delete optimizer;
+}
+}
+
+TEST_CASE("C API")
+{
+    rlo_config *config = rlo_config_load("config.yml");
+    REQUIRE(config != nullptr);
+
+    SUBCASE("Scores caller-owned tiles the same as the C++ API")
+    {
+        const rlo::Map map(rlo::map_size, std::vector<rlo::Node>{{50, 50, 1, {10, 20, 30, 40}}});
+        const std::vector<unsigned char> tiles(map.data().begin(), map.data().end());
+
+        float score = 0.f;
+        REQUIRE(rlo_evaluate(config, tiles.data(), rlo::map_size, &score) == 0);
+        CHECK(score == rlo::evaluate(map, config->config));
+
+        auto both = tiles;
+        both.insert(both.end(), tiles.begin(), tiles.end());
+        std::vector<float> scores(2);
+        REQUIRE(rlo_evaluate_batch(config, both.data(), 2, rlo::map_size, scores.data()) == 0);
+        CHECK(scores[0] == rlo::evaluate(map, config->config));
+        CHECK(scores[1] == scores[0]);
+    }
+
+    SUBCASE("Drives an optimizer to the end")
+    {
+        rlo_optimizer *optimizer = rlo_optimizer_create(config, "rooms", 1, 2, 1, 3);
+        REQUIRE(optimizer != nullptr);
+        int steps = 0;
+        while (rlo_optimizer_step(optimizer) == 1)
+        {
+            steps++;
+        }
+        std::vector<unsigned char> tiles(rlo_map_size() * rlo_map_size());
+
+        CHECK(steps == 2);
+        CHECK(rlo_optimizer_progress(optimizer) == 1.);
+        CHECK(rlo_optimizer_best_tiles(optimizer, tiles.data(), tiles.size()) == 0);
+        float score = 0.f;
+        CHECK(rlo_evaluate(config, tiles.data(), rlo_map_size(), &score) == 0);
+        CHECK(score == rlo_optimizer_best_score(optimizer));
+        CHECK(rlo_optimizer_best_tiles(optimizer, tiles.data(), 10) == -1);
+        CHECK(std::string(rlo_last_error()) == "Tile buffer is smaller than the map");
+        rlo_optimizer_free(optimizer);
+    }
+
+    SUBCASE("Reports failures")
+    {
+        std::vector<unsigned char> tiles(rlo::map_size * rlo::map_size, rlo::floor);
+        tiles[123] = 200;
+        float score = 1.f;
+        CHECK(rlo_evaluate(config, tiles.data(), rlo::map_size, &score) == -1);
+        CHECK(std::string(rlo_last_error()).find("Tile 123 is 200") != std::string::npos);
+        CHECK(score == 1.f);
+        CHECK(rlo_evaluate_batch(config, tiles.data(), 1, rlo::map_size, &score) == -1);
+        CHECK(rlo_evaluate(config, nullptr, rlo::map_size, &score) == -1);
+        CHECK(std::string(rlo_last_error()) == "No tiles given");
+        CHECK(rlo_evaluate(nullptr, tiles.data(), rlo::map_size, &score) == -1);
+        CHECK(std::string(rlo_last_error()) == "No config given");
+        CHECK(rlo_evaluate_batch(nullptr, tiles.data(), 1, rlo::map_size, &score) == -1);
+        CHECK(std::string(rlo_last_error()) == "No config given");
+
+        CHECK(rlo_optimizer_create(config, "hexagons", 1, 1, 1, 0) == nullptr);
+        CHECK(std::string(rlo_last_error()) == "Unknown genome: hexagons");
+        CHECK(rlo_optimizer_create(config, nullptr, 1, 1, 1, 0) == nullptr);
+        CHECK(std::string(rlo_last_error()) == "No genome given");
+        CHECK(rlo_optimizer_create(nullptr, "tree", 1, 1, 1, 0) == nullptr);
+        CHECK(std::string(rlo_last_error()) == "No config given");
+        CHECK(rlo_config_load("missing.yml") == nullptr);
+        CHECK(std::string(rlo_last_error()) != "");
+    }
+
+    rlo_config_free(config);
+}
\ No newline at end of file
@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <doctest/doctest.h>
@@ -8,6 +14,30 @@
 
 namespace rlo
 {
+namespace
+{
+// FNV-1a, which is plenty for telling a handful of configs apart
+class Hasher
+{
+  private:
+    std::uint64_t m_hash = 14695981039346656037ull;
+
+  public:
+    template <class T>
+    void add(const T &value)
+    {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (const auto byte : bytes)
+        {
+            m_hash = (m_hash ^ byte) * 1099511628211ull;
+        }
+    }
+
+    inline std::uint64_t hash() const { return m_hash; }
+};
+}
+
 std::unordered_map<unsigned char, rgb_t> config_to_color_map(const std::vector<RoomConfig> &config)
 {
     std::unordered_map<unsigned char, rgb_t> color_map;
@@ -72,6 +102,63 @@ std::vector<RoomConfig> read_config_from_file(const std::string &file)
     return read_config_from_yaml(yaml);
 }
 
+std::vector<RoomConfig> read_config_from_string(const std::string &yaml)
+{
+    return read_config_from_yaml(YAML::Load(yaml));
+}
+
+void check_tiles(const unsigned char *tiles, std::size_t count,
+                 const std::vector<RoomConfig> &config)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (tiles[i] >= config.size() && tiles[i] < floor)
+        {
+            throw std::invalid_argument("Tile " + std::to_string(i) + " is " +
+                                        std::to_string(tiles[i]) +
+                                        ", which isn't floor, a door, a wall or one of the " +
+                                        std::to_string(config.size()) + " room types");
+        }
+    }
+}
+
+std::uint64_t room_fingerprint(const RoomConfig &room)
+{
+    Hasher hasher;
+    hasher.add(room.type);
+    hasher.add(room.count);
+    hasher.add(room.minimum_size);
+    hasher.add(room.size_scaling);
+    hasher.add(room.movement_cost);
+    std::vector<std::pair<unsigned int, float>> weights(room.weights.begin(), room.weights.end());
+    std::sort(weights.begin(), weights.end());
+    for (const auto &[type, weight] : weights)
+    {
+        hasher.add(type);
+        hasher.add(weight);
+    }
+    for (const auto &attribute : room.attributes)
+    {
+        hasher.add(attribute.size());
+        for (const auto character : attribute)
+        {
+            hasher.add(character);
+        }
+    }
+    return hasher.hash();
+}
+
+std::uint64_t config_fingerprint(const std::vector<RoomConfig> &config, unsigned int size)
+{
+    Hasher hasher;
+    hasher.add(size);
+    for (const auto &room : config)
+    {
+        hasher.add(room_fingerprint(room));
+    }
+    return hasher.hash();
+}
+
 TEST_CASE("read_config_from_yaml()")
 {
     const std::string yaml = R"(- name: bedroom
@@ -137,4 +224,29 @@ TEST_CASE("read_config_from_yaml()")
         CHECK(config[2].weights[1] == 5.f);
     }
 }
+
+TEST_CASE("check_tiles()")
+{
+    const auto config = read_config_from_file("config.yml");
+    std::vector<unsigned char> tiles{0, floor, door, wall,
+                                     static_cast<unsigned char>(config.size() - 1)};
+
+    CHECK_NOTHROW(check_tiles(tiles.data(), tiles.size(), config));
+    tiles.push_back(static_cast<unsigned char>(config.size()));
+    CHECK_THROWS(check_tiles(tiles.data(), tiles.size(), config));
+}
+
+TEST_CASE("config_fingerprint()")
+{
+    const auto config = read_config_from_file("config.yml");
+    auto renamed = config;
+    renamed[0].name = "Renamed";
+    renamed[0].color = rgb_t{1, 2, 3};
+    auto changed = config;
+    changed[0].minimum_size++;
+
+    CHECK(config_fingerprint(renamed, 100) == config_fingerprint(config, 100));
+    CHECK(config_fingerprint(changed, 100) != config_fingerprint(config, 100));
+    CHECK(config_fingerprint(config, 50) != config_fingerprint(config, 100));
+}
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "bitmap.hpp"
 
@@ -21,6 +24,19 @@ struct RoomConfig
 };
 
 std::vector<RoomConfig> read_config_from_file(const std::string &file);
+std::vector<RoomConfig> read_config_from_string(const std::string &yaml);
 std::unordered_map<unsigned char, rgb_t>
 config_to_color_map(const std::vector<RoomConfig> &config);
+
+// Throws unless every tile is one of the config's room types, floor, a door or a wall. Tiles
+// read from outside the program must pass this before they're scored, since any other value
+// would be looked up past the end of the config.
+void check_tiles(const unsigned char *tiles, std::size_t count,
+                 const std::vector<RoomConfig> &config);
+
+// Hashes everything about a room type that changes how layouts score. Names and colours are
+// left out, so renaming or recolouring a room type keeps the same fingerprint.
+std::uint64_t room_fingerprint(const RoomConfig &room);
+// Combines the fingerprint of every room type with the map size
+std::uint64_t config_fingerprint(const std::vector<RoomConfig> &config, unsigned int size);
 }
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "daemon.hpp"
+#include "config.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "schedule.hpp"
+#include "thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace rlo
+{
+enum class JobState
+{
+    queued,
+    running,
+    finished,
+    cancelled,
+    failed
+};
+
+struct DaemonJob
+{
+    std::atomic<bool> cancel{false};
+    std::atomic<JobState> state{JobState::queued};
+    std::atomic<double> progress{0};
+    std::atomic<float> score{0};
+};
+
+const char *job_state_name(JobState state)
+{
+    switch (state)
+    {
+    case JobState::queued:
+        return "queued";
+    case JobState::running:
+        return "running";
+    case JobState::finished:
+        return "finished";
+    case JobState::cancelled:
+        return "cancelled";
+    default:
+        return "failed";
+    }
+}
+
+// Writes whole lines from any thread and flushes each one, so a client reading line by line
+// sees updates as they happen
+class LineWriter
+{
+  private:
+    std::ostream &m_stream;
+    std::mutex m_mutex;
+
+  public:
+    explicit LineWriter(std::ostream &stream) : m_stream(stream) {}
+
+    void send(const std::string &line)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stream << line << std::endl;
+    }
+};
+
+struct JobResult
+{
+    float score;
+    std::size_t evaluations;
+    double seconds;
+};
+
+template <class Genome>
+JobResult summarize(const OptimizationResult<Genome> &result)
+{
+    return {result.score, result.evaluations, result.seconds};
+}
+
+struct RunRequest
+{
+    std::string genome = "tree";
+    std::string schedule = "phased";
+    unsigned int reheat_after = 0;
+    std::string output_directory;
+    OptimizationOptions options;
+};
+
+RunRequest parse_run_parameters(std::istringstream &parameters)
+{
+    RunRequest request;
+    auto &options = request.options;
+    std::string parameter;
+    while (parameters >> parameter)
+    {
+        const auto equals = parameter.find('=');
+        if (equals == std::string::npos)
+        {
+            throw std::runtime_error("Expected key=value: " + parameter);
+        }
+        const auto key = parameter.substr(0, equals);
+        std::istringstream value(parameter.substr(equals + 1));
+        if (key == "chains")
+        {
+            value >> options.chains;
+        }
+        else if (key == "iterations")
+        {
+            value >> options.iterations;
+        }
+        else if (key == "steps")
+        {
+            value >> options.steps_per_iteration;
+        }
+        else if (key == "evaluation_threads")
+        {
+            value >> options.evaluation_threads;
+        }
+        else if (key == "speculation")
+        {
+            value >> options.speculation;
+        }
+        else if (key == "seed")
+        {
+            value >> options.seed;
+        }
+        else if (key == "time_budget")
+        {
+            value >> options.time_budget;
+        }
+        else if (key == "schedule")
+        {
+            value >> request.schedule;
+        }
+        else if (key == "reheat_after")
+        {
+            value >> request.reheat_after;
+        }
+        else if (key == "adaptive_operators")
+        {
+            value >> options.adaptive_operators;
+        }
+        else if (key == "surrogate")
+        {
+            value >> options.surrogate;
+        }
+        else if (key == "incremental_distances")
+        {
+            value >> options.incremental_distances;
+        }
+        else if (key == "fixed_point")
+        {
+            bool fixed_point = false;
+            value >> fixed_point;
+            options.arithmetic = fixed_point ? ScoreArithmetic::fixed_point
+                                             : ScoreArithmetic::floating_point;
+        }
+        else if (key == "genome")
+        {
+            value >> request.genome;
+        }
+        else if (key == "output")
+        {
+            value >> request.output_directory;
+        }
+        else
+        {
+            throw std::runtime_error("Unknown parameter: " + key);
+        }
+        if (value.fail())
+        {
+            throw std::runtime_error("Bad value for " + key);
+        }
+    }
+    if (request.genome != "tree" && request.genome != "rooms")
+    {
+        throw std::runtime_error("Unknown genome: " + request.genome);
+    }
+    options.schedule = make_schedule(request.schedule, options.iterations, request.reheat_after);
+    return request;
+}
+
+void run_daemon(std::istream &input, std::ostream &output)
+{
+    auto &pool = ThreadPool::shared();
+    LineWriter writer(output);
+    std::map<std::string, std::shared_ptr<DaemonJob>> jobs;
+    // Kept apart from the jobs, since each task holds its job and a job holding its own task
+    // would keep both alive forever. This also still waits for jobs whose id has been reused.
+    struct RunningTask
+    {
+        std::string id;
+        std::shared_ptr<DaemonJob> job;
+        std::future<void> finished;
+    };
+    std::vector<RunningTask> running;
+    // A task only returns once its job's last reply has gone out, so from then on the job can be
+    // forgotten, keeping what a long-lived daemon holds on to down to the jobs still in flight
+    const auto forget_finished = [&] {
+        for (auto task = running.begin(); task != running.end();)
+        {
+            if (task->finished.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++task;
+                continue;
+            }
+            const auto entry = jobs.find(task->id);
+            if (entry != jobs.end() && entry->second == task->job)
+            {
+                jobs.erase(entry);
+            }
+            task = running.erase(task);
+        }
+    };
+
+    // Parsed configs are reused until their file changes
+    struct CachedConfig
+    {
+        fs::file_time_type modified;
+        std::shared_ptr<const std::vector<RoomConfig>> config;
+    };
+    std::unordered_map<std::string, CachedConfig> configs;
+    const auto load_config = [&](const std::string &path) {
+        const auto modified = fs::last_write_time(path);
+        auto &cached = configs[path];
+        if (!cached.config || cached.modified != modified)
+        {
+            cached = {modified,
+                      std::make_shared<const std::vector<RoomConfig>>(read_config_from_file(path))};
+        }
+        return cached.config;
+    };
+
+    const auto start_job = [&](const std::string &id, const std::string &config_path,
+                               std::istringstream &parameters) {
+        auto request = parse_run_parameters(parameters);
+        const auto config = load_config(config_path);
+        if (request.output_directory.empty())
+        {
+            request.output_directory = (fs::path("daemon_output") / id).string();
+        }
+        fs::create_directories(request.output_directory);
+
+        auto job = std::make_shared<DaemonJob>();
+        auto &options = request.options;
+        options.output_directory = request.output_directory;
+        options.report_progress = false;
+        options.cancel = &job->cancel;
+        const auto color_map = config_to_color_map(*config);
+        const auto best_path = (fs::path(request.output_directory) / "best.bmp").string();
+        options.on_progress = [&writer, job, id, color_map, best_path](
+                                  const ProgressReport &report) {
+            job->progress = report.progress;
+            writer.send("progress " + id + " " + std::to_string(report.progress * 100.) + " " +
+                        std::to_string(report.score));
+            if (report.epoch == 0 || report.score > job->score)
+            {
+                job->score = report.score;
+                report.best.to_bitmap(color_map).save_image(best_path);
+                writer.send("best " + id + " " + std::to_string(report.score) + " " + best_path);
+            }
+        };
+
+        jobs[id] = job;
+        writer.send("started " + id);
+        auto finished = pool.submit([&writer, job, id, config, request] {
+            job->state = JobState::running;
+            try
+            {
+                const auto result =
+                    request.genome == "rooms"
+                        ? summarize(run_optimization<std::vector<Room>>(*config, request.options))
+                        : summarize(run_optimization<std::vector<Node>>(*config, request.options));
+                job->score = result.score;
+                job->progress = 1.;
+                if (job->cancel)
+                {
+                    job->state = JobState::cancelled;
+                    writer.send("cancelled " + id + " " + std::to_string(result.score));
+                }
+                else
+                {
+                    job->state = JobState::finished;
+                    writer.send("done " + id + " " + std::to_string(result.score) + " " +
+                                std::to_string(result.evaluations) + " " +
+                                std::to_string(result.seconds) + " " +
+                                request.options.output_directory);
+                }
+            }
+            catch (const std::exception &error)
+            {
+                job->state = JobState::failed;
+                writer.send("error " + id + " " + error.what());
+            }
+        });
+        running.push_back({id, job, std::move(finished)});
+    };
+
+    std::string line;
+    while (std::getline(input, line))
+    {
+        forget_finished();
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command))
+        {
+            continue;
+        }
+        try
+        {
+            if (command == "run")
+            {
+                std::string id;
+                std::string config_path;
+                if (!(words >> id >> config_path))
+                {
+                    throw std::runtime_error("Usage: run <id> <config> [key=value ...]");
+                }
+                const auto existing = jobs.find(id);
+                if (existing != jobs.end() && (existing->second->state == JobState::queued ||
+                                               existing->second->state == JobState::running))
+                {
+                    throw std::runtime_error("Job " + id + " is still running");
+                }
+                start_job(id, config_path, words);
+            }
+            else if (command == "cancel")
+            {
+                std::string id;
+                words >> id;
+                const auto job = jobs.find(id);
+                if (job == jobs.end())
+                {
+                    throw std::runtime_error("Unknown job: " + id);
+                }
+                job->second->cancel = true;
+            }
+            else if (command == "status")
+            {
+                for (const auto &[id, job] : jobs)
+                {
+                    writer.send("status " + id + " " + job_state_name(job->state) + " " +
+                                std::to_string(job->progress * 100.) + " " +
+                                std::to_string(job->score));
+                }
+                writer.send("ok status");
+            }
+            else if (command == "quit")
+            {
+                for (auto &[id, job] : jobs)
+                {
+                    job->cancel = true;
+                }
+                break;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown command: " + command);
+            }
+        }
+        catch (const std::exception &error)
+        {
+            writer.send(std::string("error ") + error.what());
+        }
+    }
+
+    for (auto &task : running)
+    {
+        task.finished.wait();
+    }
+}
+
+namespace
+{
+// Hands its lines to the daemon one at a time, calling `before_line` with each line's index
+// first, so a test can hold a command back until an earlier job has got somewhere
+class ScriptedInput : public std::streambuf
+{
+  private:
+    std::vector<std::string> m_lines;
+    std::function<void(std::size_t)> m_before_line;
+    std::size_t m_next = 0;
+    std::string m_current;
+
+  protected:
+    int_type underflow() override
+    {
+        if (m_next == m_lines.size())
+        {
+            return traits_type::eof();
+        }
+        m_before_line(m_next);
+        m_current = m_lines[m_next++] + "\n";
+        setg(m_current.data(), m_current.data(), m_current.data() + m_current.size());
+        return traits_type::to_int_type(m_current.front());
+    }
+
+  public:
+    ScriptedInput(std::vector<std::string> lines, std::function<void(std::size_t)> before_line)
+        : m_lines(std::move(lines)), m_before_line(std::move(before_line))
+    {
+    }
+};
+}
+
+TEST_CASE("run_daemon()")
+{
+    const auto output_directory = fs::temp_directory_path() / "rlo_daemon_test";
+    fs::remove_all(output_directory);
+
+    SUBCASE("Runs a job to completion and reports on it")
+    {
+        std::istringstream input("run a config.yml chains=1 iterations=2 steps=1 output=" +
+                                 output_directory.string() +
+                                 "\nbogus\ncancel missing\nrun b config.yml colour=red\n");
+        std::ostringstream output;
+        run_daemon(input, output);
+        const auto replies = output.str();
+
+        CHECK(replies.find("started a\n") != std::string::npos);
+        CHECK(replies.find("best a ") != std::string::npos);
+        CHECK(replies.find("error Unknown command: bogus\n") != std::string::npos);
+        CHECK(replies.find("error Unknown job: missing\n") != std::string::npos);
+        CHECK(replies.find("error Unknown parameter: colour\n") != std::string::npos);
+        CHECK(replies.find("started b") == std::string::npos);
+        // The end of the input lets running jobs finish
+        CHECK(replies.find("done a ") != std::string::npos);
+        CHECK(fs::exists(output_directory / "final.bmp"));
+    }
+
+    SUBCASE("Stops cancelled jobs early")
+    {
+        std::istringstream input("run a config.yml chains=1 iterations=100000 steps=1 output=" +
+                                 output_directory.string() + "\ncancel a\nquit\n");
+        std::ostringstream output;
+        run_daemon(input, output);
+
+        CHECK(output.str().find("cancelled a ") != std::string::npos);
+    }
+
+    SUBCASE("Forgets jobs once they have finished")
+    {
+        ScriptedInput script({"run a config.yml chains=1 iterations=2 steps=1 output=" +
+                                  output_directory.string(),
+                              "status"},
+                             [&](std::size_t line) {
+                                 if (line == 0)
+                                 {
+                                     return;
+                                 }
+                                 // final.bmp is saved just before the job's last reply
+                                 while (!fs::exists(output_directory / "final.bmp"))
+                                 {
+                                     std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                                 }
+                                 std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                             });
+        std::istream input(&script);
+        std::ostringstream output;
+        run_daemon(input, output);
+        const auto replies = output.str();
+
+        CHECK(replies.find("done a ") != std::string::npos);
+        CHECK(replies.find("status a ") == std::string::npos);
+        CHECK(replies.find("ok status\n") != std::string::npos);
+    }
+
+    fs::remove_all(output_directory);
+}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+namespace rlo
+{
+// Serves optimization requests over a line protocol until `quit` or the end of the input, so
+// callers running many small jobs keep the thread pool warm and don't pay process startup or
+// YAML parsing for configs they've already sent. Commands, one per line:
+//
+//   run <id> <config.yml> [key=value ...]  queue a job; keys are chains, iterations, steps,
+//                                          evaluation_threads, speculation, seed, time_budget,
+//                                          schedule, reheat_after, adaptive_operators,
+//                                          surrogate, incremental_distances, fixed_point,
+//                                          genome and output
+//   cancel <id>                            stop a job at its chains' next block boundary
+//   status                                 one `status` line per job, then `ok status`. Jobs
+//                                          are forgotten once their last reply has gone out.
+//   quit                                   cancel everything, wait for it and exit
+//
+// At the end of the input it waits for the jobs still running to finish instead.
+//
+// Replies and updates go to `output`, also one per line:
+//
+//   started <id>
+//   progress <id> <percent> <score>
+//   best <id> <score> <bitmap path>        whenever the best layout improves
+//   done <id> <score> <evaluations> <seconds> <output directory>
+//   cancelled <id> <score>
+//   error [<id>] <message>
+void run_daemon(std::istream &input, std::ostream &output);
+}
\ No newline at end of file
@@ -1,24 +1,47 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <queue>
 
 #include <doctest/doctest.h>
 
+#include "bitboard.hpp"
 #include "bitmap.hpp"
 #include "evaluate.hpp"
 #include "config.hpp"
+#include "frozen.hpp"
 #include "map.hpp"
+#include "mapped_file.hpp"
+#include "profiler.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
+#ifdef RLO_BAKED_CONFIG
+#include "baked_config.hpp"
+#endif
+
 namespace rlo
 {
-constexpr float door_cost = 1.f;
-constexpr float door_move_cost = 25.f;
-constexpr float wall_cost = 0.1f;
-
 typedef std::vector<float> CostMap;
 
+// A horizontal run of tiles on row y, covering x_begin up to but not including x_end
+struct Span
+{
+    unsigned int y;
+    unsigned int x_begin;
+    unsigned int x_end;
+};
+
 struct RoomInfo
 {
     unsigned char type;
@@ -27,284 +50,1332 @@ struct RoomInfo
     unsigned int center_y;
     unsigned int width;
     unsigned int height;
-    std::vector<std::pair<unsigned int, unsigned int>> coordinates;
+    std::vector<Span> spans;
 };
 
-std::vector<std::pair<unsigned int, unsigned int>> flood_fill(std::vector<unsigned char> &map,
-                                                              unsigned int map_size,
-                                                              unsigned int start_x,
-                                                              unsigned int start_y)
+struct FrozenAnalysis
 {
-    std::vector<std::pair<unsigned int, unsigned int>> room_coordinates;
+    unsigned int size;
+    // Movement costs with the frozen tiles filled in, and the tiles left to fill for each map
+    CostMap frozen_costs;
+    std::vector<unsigned int> free_tiles;
+    // Frozen rooms with no free tile beside them, which are the same on every map
+    std::vector<RoomInfo> sealed_rooms;
+    // Where analyze_rooms()' column by column scan would first reach each sealed room
+    std::vector<unsigned int> sealed_positions;
+};
+
+std::vector<Span> flood_fill(std::vector<unsigned char> &map, unsigned int map_size,
+                             unsigned int start_x, unsigned int start_y)
+{
+    std::vector<Span> spans;
     const auto correct_type = map[start_y * map_size + start_x];
 
-    std::queue<std::pair<unsigned int, unsigned int>> queue;
-    queue.push(std::make_pair(start_x, start_y));
+    // Scanline fill: each seed is widened into the full run of matching tiles on its row, and
+    // the rows above and below are only seeded once per run they touch
+    std::vector<std::pair<unsigned int, unsigned int>> seeds;
+    seeds.push_back(std::make_pair(start_x, start_y));
+
+    while (!seeds.empty())
+    {
+        const auto seed = seeds.back();
+        seeds.pop_back();
+
+        auto *row = &map[seed.second * map_size];
+        if (row[seed.first] != correct_type)
+        {
+            continue;
+        }
+
+        unsigned int x_begin = seed.first;
+        while (x_begin > 0 && row[x_begin - 1] == correct_type)
+        {
+            x_begin--;
+        }
+        unsigned int x_end = seed.first + 1;
+        while (x_end < map_size && row[x_end] == correct_type)
+        {
+            x_end++;
+        }
+        std::fill(row + x_begin, row + x_end, floor);
+        spans.push_back({seed.second, x_begin, x_end});
+
+        for (const auto neighbour_y : {seed.second - 1, seed.second + 1})
+        {
+            // seed.second - 1 wraps around for the top row
+            if (neighbour_y >= map_size)
+            {
+                continue;
+            }
+            const auto *neighbour_row = &map[neighbour_y * map_size];
+            for (unsigned int x = x_begin; x < x_end; x++)
+            {
+                if (neighbour_row[x] == correct_type &&
+                    (x == x_begin || neighbour_row[x - 1] != correct_type))
+                {
+                    seeds.push_back(std::make_pair(x, neighbour_y));
+                }
+            }
+        }
+    }
+
+    return spans;
+}
+
+RoomInfo describe_room(unsigned char type, std::vector<Span> spans)
+{
+    unsigned int min_x = std::numeric_limits<unsigned int>::max();
+    unsigned int min_y = std::numeric_limits<unsigned int>::max();
+    unsigned int max_x = 0;
+    unsigned int max_y = 0;
+    long unsigned int size = 0;
+    double x_sum = 0;
+    double y_sum = 0;
+    for (const auto &span : spans)
+    {
+        const auto length = span.x_end - span.x_begin;
+        min_x = std::min(span.x_begin, min_x);
+        min_y = std::min(span.y, min_y);
+        max_x = std::max(span.x_end - 1, max_x);
+        max_y = std::max(span.y, max_y);
+        size += length;
+        x_sum += static_cast<double>(span.x_begin + span.x_end - 1) * length / 2.;
+        y_sum += static_cast<double>(span.y) * length;
+    }
+
+    // The centroid of a concave room can land outside it, so use the closest tile that's
+    // actually in the room. Ties go to the topmost, then leftmost, tile so the center doesn't
+    // depend on the order the flood fill found the spans in.
+    const auto centroid_x = std::round(x_sum / static_cast<double>(size));
+    const auto centroid_y = std::round(y_sum / static_cast<double>(size));
+    double closest_distance = std::numeric_limits<double>::infinity();
+    unsigned int center_x = 0;
+    unsigned int center_y = 0;
+    for (const auto &span : spans)
+    {
+        const auto x = std::clamp(centroid_x, static_cast<double>(span.x_begin),
+                                  static_cast<double>(span.x_end - 1));
+        const auto distance = (x - centroid_x) * (x - centroid_x) +
+                              (span.y - centroid_y) * (span.y - centroid_y);
+        if (distance < closest_distance ||
+            (distance == closest_distance &&
+             std::make_pair(span.y, static_cast<unsigned int>(x)) <
+                 std::make_pair(center_y, center_x)))
+        {
+            closest_distance = distance;
+            center_x = static_cast<unsigned int>(x);
+            center_y = span.y;
+        }
+    }
+
+    return {type,     size, center_x, center_y, max_x + 1 - min_x, max_y + 1 - min_y,
+            std::move(spans)};
+}
+
+std::vector<RoomInfo> analyze_rooms(const Map &map, std::vector<unsigned char> &temp_map,
+                                    const FrozenAnalysis *frozen = nullptr)
+{
+    std::vector<RoomInfo> rooms;
+    const auto tiles = map.data();
+    temp_map.assign(tiles.begin(), tiles.end());
+
+    // Sealed rooms are blanked out so the scan skips them, then slotted in where the scan would
+    // have found them, so the rooms come out in the same order as without a frozen mask
+    std::size_t next_sealed = 0;
+    const auto sealed_count = frozen != nullptr ? frozen->sealed_rooms.size() : 0;
+    for (std::size_t i = 0; i < sealed_count; i++)
+    {
+        for (const auto &span : frozen->sealed_rooms[i].spans)
+        {
+            std::fill(temp_map.begin() + span.y * map.size() + span.x_begin,
+                      temp_map.begin() + span.y * map.size() + span.x_end, floor);
+        }
+    }
+
+    for (unsigned int x = 0; x < map.size(); x++)
+    {
+        for (unsigned int y = 0; y < map.size(); y++)
+        {
+            while (next_sealed < sealed_count &&
+                   frozen->sealed_positions[next_sealed] == x * map.size() + y)
+            {
+                rooms.push_back(frozen->sealed_rooms[next_sealed++]);
+            }
+            const auto tile = temp_map[y * map.size() + x];
+            if (tile < floor)
+            {
+                rooms.push_back(describe_room(tile, flood_fill(temp_map, map.size(), x, y)));
+            }
+        }
+    }
+    return rooms;
+}
+
+std::vector<RoomInfo> analyze_rooms(const Map &map)
+{
+    std::vector<unsigned char> temp_map;
+    return analyze_rooms(map, temp_map);
+}
+
+// How evaluate() adds up a score: the costs its distance searches sum, and the terms it adds
+class FloatArithmetic
+{
+  public:
+    typedef float Cost;
+    typedef float Score;
+    static constexpr Cost unreachable = std::numeric_limits<float>::infinity();
+
+    static constexpr Cost cost(float movement_cost) { return movement_cost; }
+    static constexpr Score term(float value) { return value; }
+    static constexpr Score distance_term(Cost distance, float weight)
+    {
+        return -(distance * weight);
+    }
+};
+
+// Rounds costs, weights and terms to integers of fixed_cost_bits, fixed_weight_bits and
+// fixed_score_bits fractional bits. Integer sums are exact, so the total comes out the same
+// whatever order the terms are added in.
+class FixedArithmetic
+{
+  public:
+    typedef std::int64_t Cost;
+    typedef std::int64_t Score;
+    static constexpr Cost unreachable = std::numeric_limits<Cost>::max();
+
+    static Cost cost(float movement_cost)
+    {
+        return movement_cost == std::numeric_limits<float>::infinity()
+                   ? unreachable
+                   : std::llround(std::ldexp(static_cast<double>(movement_cost), fixed_cost_bits));
+    }
+    static Score term(float value)
+    {
+        return std::llround(std::ldexp(static_cast<double>(value), fixed_score_bits));
+    }
+    static Score distance_term(Cost distance, float weight)
+    {
+        return -(distance *
+                 std::llround(std::ldexp(static_cast<double>(weight), fixed_weight_bits)));
+    }
+};
+
+// Where evaluate() reads the config's numbers from. These tables work for any config.
+class RuntimeScoring
+{
+  private:
+    const EvaluationTables &m_tables;
+
+  public:
+    explicit RuntimeScoring(const EvaluationTables &tables) : m_tables(tables) {}
+
+    inline std::size_t room_types() const { return m_tables.config().size(); }
+    inline unsigned int count(std::size_t type) const { return m_tables.config()[type].count; }
+    inline unsigned int minimum_size(unsigned char type) const
+    {
+        return m_tables.config()[type].minimum_size;
+    }
+    inline float size_scaling(unsigned char type) const
+    {
+        return m_tables.config()[type].size_scaling;
+    }
+    inline float movement_cost(unsigned char tile) const { return m_tables.movement_cost(tile); }
+    inline const float *weight(unsigned char type, unsigned char target) const
+    {
+        return m_tables.weight(type, target);
+    }
+};
+
+#ifdef RLO_BAKED_CONFIG
+// The same numbers for the config the build was specialized on, as compile-time constants. The
+// room count loop runs a known number of times and type pairs without a weight are known up
+// front, so the compiler can unroll and fold those checks.
+class BakedScoring
+{
+  public:
+    static constexpr std::size_t room_types() { return baked::room_types; }
+    static constexpr unsigned int count(std::size_t type) { return baked::counts[type]; }
+    static constexpr unsigned int minimum_size(unsigned char type)
+    {
+        return baked::minimum_sizes[type];
+    }
+    static constexpr float size_scaling(unsigned char type) { return baked::size_scalings[type]; }
+    static constexpr float movement_cost(unsigned char tile) { return baked::movement_costs[tile]; }
+    static constexpr const float *weight(unsigned char type, unsigned char target)
+    {
+        return type < baked::room_types && target < baked::room_types &&
+                       baked::has_weight[type][target]
+                   ? &baked::weights[type][target]
+                   : nullptr;
+    }
+};
+#endif
+
+template <class Arithmetic, class Scoring>
+void fill_costmap(const Map &map, const EvaluationTables &tables, const Scoring &scoring,
+                  std::vector<typename Arithmetic::Cost> &cost_map)
+{
+    const auto tiles = map.data();
+    if (const auto *frozen = tables.frozen_analysis())
+    {
+        cost_map.resize(frozen->frozen_costs.size());
+        std::transform(frozen->frozen_costs.begin(), frozen->frozen_costs.end(), cost_map.begin(),
+                       Arithmetic::cost);
+        for (const auto index : frozen->free_tiles)
+        {
+            cost_map[index] = Arithmetic::cost(scoring.movement_cost(tiles[index]));
+        }
+        return;
+    }
+    cost_map.resize(tiles.size());
+    for (std::size_t i = 0; i < tiles.size(); i++)
+    {
+        cost_map[i] = Arithmetic::cost(scoring.movement_cost(tiles[i]));
+    }
+}
+
+void fill_costmap(const Map &map, const EvaluationTables &tables, CostMap &cost_map)
+{
+    fill_costmap<FloatArithmetic>(map, tables, RuntimeScoring(tables), cost_map);
+}
+
+CostMap create_costmap(const Map &map, const std::vector<RoomConfig> &config)
+{
+    CostMap cost_map;
+    fill_costmap(map, EvaluationTables(config), cost_map);
+    return cost_map;
+}
+
+// Working memory for distance searches, kept between searches on the same thread
+template <class Cost>
+struct DistanceScratch
+{
+    std::vector<bool> visited;
+    std::vector<std::pair<unsigned int, Cost>> queue;
+};
+
+template <class Arithmetic>
+void distance_map(const std::vector<typename Arithmetic::Cost> &cost_map,
+                  const std::vector<Span> &sources, unsigned int map_size,
+                  DistanceScratch<typename Arithmetic::Cost> &scratch,
+                  std::vector<typename Arithmetic::Cost> &result)
+{
+    typedef typename Arithmetic::Cost Cost;
+    constexpr auto unreachable = Arithmetic::unreachable;
+    result.assign(map_size * map_size, unreachable);
+
+    // A binary heap kept in the scratch buffer, ordered exactly like the std::priority_queue it
+    // replaces so ties between equal costs resolve the same way
+    const auto prioritize = [](const std::pair<unsigned int, Cost> &p1,
+                               const std::pair<unsigned int, Cost> &p2) {
+        return p1.second > p2.second;
+    };
+    auto &queue = scratch.queue;
+    queue.clear();
+    const auto push = [&](unsigned int index, Cost cost) {
+        queue.emplace_back(index, cost);
+        std::push_heap(queue.begin(), queue.end(), prioritize);
+    };
+    auto &visited = scratch.visited;
+    visited.assign(map_size * map_size, false);
+
+    const auto push_neighbours = [&](unsigned int index, Cost cost) {
+        if (index > map_size && cost_map[index - map_size] != unreachable)
+        {
+            push(index - map_size, cost);
+        }
+        if (index < map_size * map_size - map_size && cost_map[index + map_size] != unreachable)
+        {
+            push(index + map_size, cost);
+        }
+        if (index % map_size > 0 && cost_map[index - 1] != unreachable)
+        {
+            push(index - 1, cost);
+        }
+        if (index % map_size < map_size - 1 && cost_map[index + 1] != unreachable)
+        {
+            push(index + 1, cost);
+        }
+    };
+
+    // Moving around inside the source room is free, so all of its tiles start at zero
+    for (const auto &span : sources)
+    {
+        for (unsigned int x = span.x_begin; x < span.x_end; x++)
+        {
+            visited[span.y * map_size + x] = true;
+            result[span.y * map_size + x] = Cost{0};
+        }
+    }
+    for (const auto &span : sources)
+    {
+        for (unsigned int x = span.x_begin; x < span.x_end; x++)
+        {
+            push_neighbours(span.y * map_size + x, Cost{0});
+        }
+    }
 
     while (!queue.empty())
     {
-        const auto point = queue.front();
-        queue.pop();
+        std::pop_heap(queue.begin(), queue.end(), prioritize);
+        const auto point = queue.back();
+        queue.pop_back();
 
-        if (point.first >= map_size || point.second >= map_size ||
-            map[point.second * map_size + point.first] != correct_type)
+        if (visited[point.first])
         {
             continue;
         }
+        visited[point.first] = true;
+
+        const Cost cost = point.second + cost_map[point.first];
+        result[point.first] = cost;
+
+        push_neighbours(point.first, cost);
+    }
+}
 
-        room_coordinates.push_back(point);
-        map[point.second * map_size + point.first] = floor;
+std::vector<float> distance_map(const CostMap &cost_map, const std::vector<Span> &sources,
+                                unsigned int map_size)
+{
+    DistanceScratch<float> scratch;
+    std::vector<float> result;
+    distance_map<FloatArithmetic>(cost_map, sources, map_size, scratch, result);
+    return result;
+}
 
-        if (point.first > 0)
+// Calls `visit` with each tile a search steps to from `index`, in the order distance_map() pushes
+// them. Tile 0 is never stepped to from the tile below it.
+template <class Visit>
+void for_each_successor(unsigned int index, unsigned int map_size, Visit &&visit)
+{
+    if (index > map_size)
+    {
+        visit(index - map_size);
+    }
+    if (index < map_size * map_size - map_size)
+    {
+        visit(index + map_size);
+    }
+    if (index % map_size > 0)
+    {
+        visit(index - 1);
+    }
+    if (index % map_size < map_size - 1)
+    {
+        visit(index + 1);
+    }
+}
+
+// The tiles a search steps to `index` from, the reverse of for_each_successor()
+template <class Visit>
+void for_each_predecessor(unsigned int index, unsigned int map_size, Visit &&visit)
+{
+    if (index > 0 && index < map_size * map_size - map_size)
+    {
+        visit(index + map_size);
+    }
+    if (index >= map_size)
+    {
+        visit(index - map_size);
+    }
+    if (index % map_size < map_size - 1)
+    {
+        visit(index + 1);
+    }
+    if (index % map_size > 0)
+    {
+        visit(index - 1);
+    }
+}
+
+Bitboard span_mask(const std::vector<Span> &spans, unsigned int map_size)
+{
+    Bitboard mask(map_size);
+    for (const auto &span : spans)
+    {
+        for (unsigned int x = span.x_begin; x < span.x_end; x++)
+        {
+            mask.set(x, span.y);
+        }
+    }
+    return mask;
+}
+
+// The distances from one room, kept from the map they were last searched or repaired on
+template <class Cost>
+struct DistanceField
+{
+    unsigned char type;
+    std::vector<Span> spans;
+    Bitboard sources;
+    std::vector<Cost> distances;
+    // What the repair for the map last evaluated overwrote, to put back if it isn't accepted
+    std::vector<std::pair<unsigned int, Cost>> undo;
+    std::vector<Span> previous_spans;
+    Bitboard previous_sources;
+};
+
+// Working memory for repairs, kept between repairs on the same thread
+template <class Cost>
+struct RepairScratch
+{
+    std::vector<unsigned int> changed;
+    std::vector<bool> reset;
+    std::vector<unsigned int> reset_tiles;
+    std::vector<unsigned int> stack;
+    std::vector<std::pair<unsigned int, Cost>> queue;
+};
+
+// Brings a field searched on a map with `old_costs` and its previous sources up to date with
+// `cost_map` and its current sources, changing only the distances that differ. A search sets
+// each tile to the smallest of its predecessors' distances plus its own cost, and the repair
+// keeps to exactly that. Returns how many distances it reset or settled.
+template <class Arithmetic>
+std::size_t repair_distances(const std::vector<typename Arithmetic::Cost> &old_costs,
+                             const std::vector<typename Arithmetic::Cost> &cost_map,
+                             const std::vector<unsigned int> &changed_costs,
+                             unsigned int map_size, DistanceField<typename Arithmetic::Cost> &field,
+                             RepairScratch<typename Arithmetic::Cost> &scratch)
+{
+    typedef typename Arithmetic::Cost Cost;
+    constexpr auto unreachable = Arithmetic::unreachable;
+    auto &distances = field.distances;
+    const auto is_source = [&](unsigned int index) {
+        return field.sources.get(index % map_size, index / map_size);
+    };
+    const auto set_distance = [&](unsigned int index, Cost distance) {
+        field.undo.emplace_back(index, distances[index]);
+        distances[index] = distance;
+    };
+
+    auto &changed = scratch.changed;
+    changed.assign(changed_costs.begin(), changed_costs.end());
+    for (const auto &span : field.spans)
+    {
+        for (unsigned int x = span.x_begin; x < span.x_end; x++)
+        {
+            if (!field.previous_sources.get(x, span.y))
+            {
+                changed.push_back(span.y * map_size + x);
+            }
+        }
+    }
+    for (const auto &span : field.previous_spans)
+    {
+        for (unsigned int x = span.x_begin; x < span.x_end; x++)
+        {
+            if (!field.sources.get(x, span.y))
+            {
+                changed.push_back(span.y * map_size + x);
+            }
+        }
+    }
+
+    // First reset every distance that was worked out through a changed tile, following each
+    // tile to the successors whose distances it accounts for. Whatever is left was reached by a
+    // path the changes didn't touch, so it still holds.
+    auto &reset = scratch.reset;
+    auto &reset_tiles = scratch.reset_tiles;
+    auto &stack = scratch.stack;
+    reset.resize(distances.size(), false);
+    reset_tiles.clear();
+    stack.clear();
+    const auto mark = [&](unsigned int index) {
+        if (!reset[index])
+        {
+            reset[index] = true;
+            reset_tiles.push_back(index);
+            stack.push_back(index);
+        }
+    };
+    for (const auto index : changed)
+    {
+        mark(index);
+    }
+    while (!stack.empty())
+    {
+        const auto index = stack.back();
+        stack.pop_back();
+        const auto distance = distances[index];
+        if (distance == unreachable)
+        {
+            continue;
+        }
+        for_each_successor(index, map_size, [&](unsigned int next) {
+            if (!reset[next] && !is_source(next) && old_costs[next] != unreachable &&
+                distances[next] == distance + old_costs[next])
+            {
+                mark(next);
+            }
+        });
+    }
+    for (const auto index : reset_tiles)
+    {
+        reset[index] = false;
+        if (distances[index] != unreachable)
+        {
+            set_distance(index, unreachable);
+        }
+    }
+
+    // Then search again from the distances the reset tiles can get from their neighbours, only
+    // continuing where the search lowers a distance
+    const auto prioritize = [](const std::pair<unsigned int, Cost> &p1,
+                               const std::pair<unsigned int, Cost> &p2) {
+        return p1.second > p2.second;
+    };
+    auto &queue = scratch.queue;
+    queue.clear();
+    const auto push = [&](unsigned int index, Cost distance) {
+        queue.emplace_back(index, distance);
+        std::push_heap(queue.begin(), queue.end(), prioritize);
+    };
+    for (const auto index : reset_tiles)
+    {
+        if (is_source(index))
+        {
+            push(index, Cost{0});
+            continue;
+        }
+        if (cost_map[index] == unreachable)
+        {
+            continue;
+        }
+        auto nearest = unreachable;
+        for_each_predecessor(index, map_size, [&](unsigned int previous) {
+            nearest = std::min(nearest, distances[previous]);
+        });
+        if (nearest != unreachable)
+        {
+            push(index, nearest + cost_map[index]);
+        }
+    }
+    std::size_t settled = 0;
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), prioritize);
+        const auto point = queue.back();
+        queue.pop_back();
+        if (point.second >= distances[point.first])
+        {
+            continue;
+        }
+        set_distance(point.first, point.second);
+        settled++;
+        for_each_successor(point.first, map_size, [&](unsigned int next) {
+            if (!is_source(next) && cost_map[next] != unreachable &&
+                point.second + cost_map[next] < distances[next])
+            {
+                push(next, point.second + cost_map[next]);
+            }
+        });
+    }
+    return reset_tiles.size() + settled;
+}
+
+// The fields of one arithmetic's distances
+template <class Cost>
+struct FieldSet
+{
+    const EvaluationTables *tables = nullptr;
+    unsigned int map_size = 0;
+    // The costs of the accepted map and the fields of its rooms
+    std::vector<Cost> cost_map;
+    std::vector<DistanceField<Cost>> fields;
+
+    // For the map last evaluated: its costs, the tiles where they differ from the accepted map's,
+    // the accepted field each room was matched to if any, the fields searched from scratch for it
+    // and which rooms used a field at all (as chars, since rooms set them from several threads)
+    std::vector<Cost> candidate_costs;
+    std::vector<unsigned int> changed_costs;
+    std::vector<std::size_t> room_fields;
+    std::vector<DistanceField<Cost>> fresh;
+    std::vector<char> used;
+    std::vector<std::size_t> repaired_tiles;
+    bool pending = false;
+
+    void rollback()
+    {
+        if (!pending)
         {
-            queue.push(std::make_pair(point.first - 1, point.second));
+            return;
         }
-        if (point.second > 0)
+        for (const auto index : room_fields)
         {
-            queue.push(std::make_pair(point.first, point.second - 1));
+            if (index == fields.size())
+            {
+                continue;
+            }
+            auto &field = fields[index];
+            for (auto undo = field.undo.rbegin(); undo != field.undo.rend(); undo++)
+            {
+                field.distances[undo->first] = undo->second;
+            }
+            field.undo.clear();
+            field.spans = std::move(field.previous_spans);
+            field.sources = std::move(field.previous_sources);
         }
-        if (point.first < map_size)
+        room_fields.clear();
+        pending = false;
+    }
+
+    void accept()
+    {
+        if (!pending)
         {
-            queue.push(std::make_pair(point.first + 1, point.second));
+            return;
         }
-        if (point.second < map_size)
+        std::vector<DistanceField<Cost>> kept;
+        for (std::size_t room = 0; room < room_fields.size(); room++)
         {
-            queue.push(std::make_pair(point.first, point.second + 1));
+            if (!used[room])
+            {
+                continue;
+            }
+            auto &field =
+                room_fields[room] == fields.size() ? fresh[room] : fields[room_fields[room]];
+            field.undo.clear();
+            kept.push_back(std::move(field));
         }
+        fields = std::move(kept);
+        cost_map.swap(candidate_costs);
+        room_fields.clear();
+        pending = false;
     }
+};
+
+std::shared_ptr<const FrozenAnalysis> analyze_frozen(const FrozenMask &frozen,
+                                                     const EvaluationTables &tables)
+{
+    auto analysis = std::make_shared<FrozenAnalysis>();
+    const auto size = frozen.size();
+    analysis->size = size;
+    const Map frozen_map(size, frozen.tiles());
+    fill_costmap(frozen_map, tables, analysis->frozen_costs);
+    for (unsigned int index = 0; index < size * size; index++)
+    {
+        if (!frozen.contains(index % size, index / size))
+        {
+            analysis->free_tiles.push_back(index);
+        }
+    }
+
+    // Free tiles are floor on the mask, so these are exactly the frozen rooms. One that touches a
+    // free tile can grow into it, but the rest look the same on every map.
+    const auto touches_free_tile = [&](const RoomInfo &room) {
+        for (const auto &span : room.spans)
+        {
+            for (unsigned int x = span.x_begin; x < span.x_end; x++)
+            {
+                if ((x > 0 && !frozen.contains(x - 1, span.y)) ||
+                    (x + 1 < size && !frozen.contains(x + 1, span.y)) ||
+                    (span.y > 0 && !frozen.contains(x, span.y - 1)) ||
+                    (span.y + 1 < size && !frozen.contains(x, span.y + 1)))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    std::vector<unsigned char> temp_map;
+    for (auto &room : analyze_rooms(frozen_map, temp_map))
+    {
+        if (touches_free_tile(room))
+        {
+            continue;
+        }
+        unsigned int position = size * size;
+        for (const auto &span : room.spans)
+        {
+            position = std::min(position, span.x_begin * size + span.y);
+        }
+        analysis->sealed_positions.push_back(position);
+        analysis->sealed_rooms.push_back(std::move(room));
+    }
+    return analysis;
+}
 
-    return room_coordinates;
+EvaluationTables::EvaluationTables(const std::vector<RoomConfig> &config,
+                                   const FrozenMask *frozen, ScoreArithmetic arithmetic)
+    : m_config(&config), m_frozen(frozen), m_arithmetic(arithmetic),
+      m_has_weight(config.size() * 256, false), m_weights(config.size() * 256, 0.f)
+{
+#ifdef RLO_BAKED_CONFIG
+    m_specialized = config_fingerprint(config, 0) == baked::fingerprint;
+#endif
+    // Tiles that aren't in the config cost the same to cross as floor
+    m_movement_costs.fill(1.f);
+    m_tile_penalties.fill(0.f);
+    for (std::size_t type = 0; type < config.size() && type < floor; type++)
+    {
+        m_movement_costs[type] = config[type].movement_cost;
+        for (const auto &[target, weight] : config[type].weights)
+        {
+            if (target < 256)
+            {
+                m_has_weight[type * 256 + target] = true;
+                m_weights[type * 256 + target] = weight;
+            }
+        }
+    }
+    m_movement_costs[floor] = 1.f;
+    m_movement_costs[door] = door_move_cost;
+    m_movement_costs[wall] = std::numeric_limits<float>::infinity();
+    m_tile_penalties[door] = door_cost;
+    m_tile_penalties[wall] = wall_cost;
+
+    if (frozen != nullptr)
+    {
+        m_frozen_analysis = analyze_frozen(*frozen, *this);
+    }
+}
+
+EvaluationTables::EvaluationTables(const std::vector<RoomConfig> &config,
+                                   const EvaluationTables &tables)
+    : EvaluationTables(tables)
+{
+    m_config = &config;
+}
+
+// Reused by every evaluation on the same thread, so steady-state scoring doesn't allocate for
+// the working copy of the tiles, the costmap or the distance searches
+thread_local std::vector<unsigned char> scratch_tiles;
+
+// One set of each for floating and fixed point costs
+template <class Arithmetic>
+struct CostScratch
+{
+    std::vector<typename Arithmetic::Cost> cost_map;
+    DistanceScratch<typename Arithmetic::Cost> distance;
+    std::vector<typename Arithmetic::Cost> distances;
+    RepairScratch<typename Arithmetic::Cost> repair;
+};
+
+template <class Arithmetic>
+CostScratch<Arithmetic> &cost_scratch()
+{
+    thread_local CostScratch<Arithmetic> scratch;
+    return scratch;
+}
+
+struct DistanceFields
+{
+    FieldSet<float> floating;
+    FieldSet<std::int64_t> fixed;
+    DistanceCacheStatistics statistics;
+
+    template <class Cost>
+    FieldSet<Cost> &get()
+    {
+        if constexpr (std::is_same_v<Cost, float>)
+        {
+            return floating;
+        }
+        else
+        {
+            return fixed;
+        }
+    }
+};
+
+void DistanceCacheStatistics::merge(const DistanceCacheStatistics &other)
+{
+    repaired += other.repaired;
+    searched += other.searched;
+    repaired_tiles += other.repaired_tiles;
+}
+
+DistanceCache::DistanceCache() : m_fields(std::make_unique<DistanceFields>()) {}
+DistanceCache::~DistanceCache() = default;
+DistanceCache::DistanceCache(DistanceCache &&other) noexcept = default;
+DistanceCache &DistanceCache::operator=(DistanceCache &&other) noexcept = default;
+
+void DistanceCache::accept()
+{
+    m_fields->floating.accept();
+    m_fields->fixed.accept();
+}
+
+const DistanceCacheStatistics &DistanceCache::statistics() const
+{
+    return m_fields->statistics;
 }
 
-std::vector<RoomInfo> analyze_rooms(const Map &map)
+// Gets the fields ready for scoring `map`: undoes the repairs for the last map if it wasn't
+// accepted, then matches each room to the accepted field of a room of the same type containing
+// its center, unless so much changed that searching from scratch would be cheaper
+template <class Arithmetic>
+void match_fields(const Map &map, const EvaluationTables &tables,
+                  const std::vector<typename Arithmetic::Cost> &cost_map,
+                  const std::vector<RoomInfo> &room_infos,
+                  FieldSet<typename Arithmetic::Cost> &set)
 {
-    std::vector<RoomInfo> rooms;
-    std::vector<unsigned char> temp_map(map.data());
-    for (unsigned int x = 0; x < map.size(); x++)
+    set.rollback();
+    if (set.tables != &tables || set.map_size != map.size())
     {
-        for (unsigned int y = 0; y < map.size(); y++)
+        set = {};
+        set.tables = &tables;
+        set.map_size = map.size();
+    }
+    set.candidate_costs = cost_map;
+    set.changed_costs.clear();
+    if (!set.fields.empty())
+    {
+        for (unsigned int i = 0; i < cost_map.size(); i++)
         {
-            const auto tile = temp_map[y * map.size() + x];
-            if (tile < floor)
+            if (cost_map[i] != set.cost_map[i])
             {
-                const auto room_coordinates = flood_fill(temp_map, map.size(), x, y);
-                unsigned int min_x = std::numeric_limits<unsigned int>::max();
-                unsigned int min_y = std::numeric_limits<unsigned int>::max();
-                unsigned int max_x = 0;
-                unsigned int max_y = 0;
-                for (const auto &coordinate : room_coordinates)
-                {
-                    min_x = std::min(coordinate.first, min_x);
-                    min_y = std::min(coordinate.second, min_y);
-                    max_x = std::max(coordinate.first, max_x);
-                    max_y = std::max(coordinate.second, max_y);
-                }
-                rooms.emplace_back(RoomInfo{tile, room_coordinates.size(),
-                                            room_coordinates[room_coordinates.size() / 2].first,
-                                            room_coordinates[room_coordinates.size() / 2].second,
-                                            max_x + 1 - min_x, max_y + 1 - min_y,
-                                            room_coordinates});
+                set.changed_costs.push_back(i);
             }
         }
     }
-    return rooms;
-}
 
-CostMap create_costmap(const Map &map, const std::vector<RoomConfig> &config)
-{
-    CostMap cost_map(map.size() * map.size());
-
-    for (unsigned int x = 0; x < map.size(); x++)
+    const auto limit = cost_map.size() / 4;
+    std::vector<bool> claimed(set.fields.size(), false);
+    set.room_fields.assign(room_infos.size(), set.fields.size());
+    set.fresh.resize(room_infos.size());
+    set.used.assign(room_infos.size(), 0);
+    set.repaired_tiles.assign(room_infos.size(), 0);
+    for (std::size_t room_index = 0; room_index < room_infos.size(); room_index++)
     {
-        for (unsigned int y = 0; y < map.size(); y++)
+        const auto &room = room_infos[room_index];
+        if (room.size < 9 || set.changed_costs.size() > limit)
         {
-            unsigned char tile = map.get(x, y);
-
-            if (tile == floor)
-            {
-                cost_map[y * map.size() + x] = 1.;
-            }
-            else if (tile == door)
-            {
-                cost_map[y * map.size() + x] = door_move_cost;
-            }
-            else if (tile == wall)
+            continue;
+        }
+        for (std::size_t i = 0; i < set.fields.size(); i++)
+        {
+            auto &field = set.fields[i];
+            if (claimed[i] || field.type != room.type ||
+                !field.sources.get(room.center_x, room.center_y))
             {
-                cost_map[y * map.size() + x] = std::numeric_limits<float>::infinity();
+                continue;
             }
-            else
+            auto sources = span_mask(room.spans, map.size());
+            auto difference = field.sources;
+            difference &= ~sources;
+            auto added = sources;
+            added &= ~field.sources;
+            if (set.changed_costs.size() + difference.count() + added.count() <= limit)
             {
-                cost_map[y * map.size() + x] = config[tile].movement_cost;
+                claimed[i] = true;
+                set.room_fields[room_index] = i;
+                field.previous_spans = std::move(field.spans);
+                field.previous_sources = std::move(field.sources);
+                field.spans = room.spans;
+                field.sources = std::move(sources);
             }
+            break;
         }
     }
-
-    return cost_map;
+    set.pending = true;
 }
 
-std::vector<float> distance_map(const CostMap &cost_map, unsigned int start_x,
-                                unsigned int start_y, unsigned int map_size)
+float evaluate(const Map &map, const std::vector<RoomConfig> &config,
+               const EvaluationParallelism &parallelism)
 {
-    std::vector<float> result(map_size * map_size, std::numeric_limits<float>::infinity());
+    return evaluate(map, EvaluationTables(config), parallelism);
+}
 
-    class Prioritize
+// Finds the connected region of non-wall tiles around each room, naming each region by the
+// index of the room that first reached it
+void find_regions(const Map &map, const std::vector<RoomInfo> &room_infos,
+                  std::vector<Bitboard> &regions, std::vector<std::size_t> &room_regions)
+{
+    const auto passable = map.passable();
+    for (const auto &room : room_infos)
     {
-      public:
-        bool operator()(std::pair<unsigned int, float> &p1, std::pair<unsigned int, float> &p2)
+        const auto region = std::find_if(regions.begin(), regions.end(), [&](const auto &region) {
+            return region.get(room.center_x, room.center_y);
+        });
+        room_regions.push_back(static_cast<std::size_t>(region - regions.begin()));
+        if (region == regions.end())
         {
-            return p1.second > p2.second;
+            regions.push_back(passable.flood_fill(room.center_x, room.center_y));
         }
-    };
-
-    std::priority_queue<std::pair<unsigned int, float>,
-                        std::vector<std::pair<unsigned int, float>>, Prioritize>
-        queue;
-    std::vector<bool> visited(map_size * map_size, false);
+    }
+}
 
-    queue.push(std::make_pair(start_y * map_size + start_x, 0));
+// The terms for a room's size and shape. Returns false for rooms too small to count, which get
+// a flat penalty and nothing else.
+template <class Arithmetic, class Scoring>
+bool add_shape_terms(const RoomInfo &room, const Scoring &scoring,
+                     std::vector<typename Arithmetic::Score> &terms)
+{
+    if (room.size < 9)
+    {
+        terms.push_back(Arithmetic::term(-100.f));
+        return false;
+    }
+    const auto minimum_size = scoring.minimum_size(room.type);
 
-    while (!queue.empty())
+    // Size
+    const auto max_room_size = minimum_size * 4;
+    if (room.size < minimum_size)
+    {
+        terms.push_back(Arithmetic::term(-1000.f));
+    }
+    else if (room.size < max_room_size)
     {
-        const auto point = queue.top();
-        queue.pop();
+        terms.push_back(Arithmetic::term(static_cast<float>(room.size - minimum_size) *
+                                         scoring.size_scaling(room.type)));
+    }
 
-        if (visited[point.first])
-        {
-            continue;
-        }
-        visited[point.first] = true;
+    // Aspect ratio
+    terms.push_back(Arithmetic::term(
+        -static_cast<float>(
+            std::abs(static_cast<short>(room.width) - static_cast<short>(room.height))) *
+        10.f));
+    if (room.width < 3 || room.height < 3)
+    {
+        terms.push_back(Arithmetic::term(-100.f));
+    }
 
-        const float cost = point.second + cost_map[point.first];
-        result[point.first] = cost;
+    // Room shape
+    // We calculate the expected area if the room was a rectangle, and any difference between
+    // that and the actual area is considered bad.
+    terms.push_back(Arithmetic::term(
+        -static_cast<float>(room.width * room.height - static_cast<int>(room.size))));
+    return true;
+}
 
-        if (point.first > map_size &&
-            cost_map[point.first - map_size] != std::numeric_limits<float>::infinity())
-        {
-            queue.push(std::make_pair(point.first - map_size, cost));
-        }
-        if (point.first < map_size * map_size - map_size &&
-            cost_map[point.first + map_size] != std::numeric_limits<float>::infinity())
-        {
-            queue.push(std::make_pair(point.first + map_size, cost));
-        }
-        if (point.first % map_size > 0 &&
-            cost_map[point.first - 1] != std::numeric_limits<float>::infinity())
+// Room counts and per-tile penalties, which depend on the whole map rather than any one room
+template <class Arithmetic, class Scoring>
+void add_global_terms(const Map &map, const EvaluationTables &tables, const Scoring &scoring,
+                      const std::vector<RoomInfo> &room_infos, typename Arithmetic::Score &score)
+{
+    // Room count
+    for (std::size_t i = 0; i < scoring.room_types(); i++)
+    {
+        unsigned int room_count = 0;
+        for (const auto &room : room_infos)
         {
-            queue.push(std::make_pair(point.first - 1, cost));
+            if (room.size >= 9 && room.type == i)
+            {
+                room_count++;
+            }
         }
-        if (point.first % map_size < map_size - 1 &&
-            cost_map[point.first + 1] != std::numeric_limits<float>::infinity())
+        if (room_count != scoring.count(i))
         {
-            queue.push(std::make_pair(point.first + 1, cost));
+            score += Arithmetic::term(
+                -(15000.f * static_cast<float>(std::abs(static_cast<short>(room_count) -
+                                                        static_cast<short>(scoring.count(i))))));
         }
     }
 
-    return result;
+    // Individual tiles
+    for (const auto &tile : map.data())
+    {
+        score += Arithmetic::term(-tables.tile_penalty(tile));
+    }
 }
 
-float evaluate(const Map &map, const std::vector<RoomConfig> &config)
+template <class Arithmetic, class Scoring>
+typename Arithmetic::Score evaluate(const Map &map, const EvaluationTables &tables,
+                                    const Scoring &scoring,
+                                    const EvaluationParallelism &parallelism, DistanceCache *cache)
 {
-    float score = 0.f;
-
-    const auto cost_map = create_costmap(map, config);
-    const auto room_infos = analyze_rooms(map);
+    typedef typename Arithmetic::Score Score;
+    Score score{0};
+    const auto *frozen = tables.frozen_analysis();
+    if (frozen != nullptr && frozen->size != map.size())
+    {
+        throw std::invalid_argument("Map doesn't match the size of the frozen mask");
+    }
 
-    // Individual room operations
-    for (const auto &room : room_infos)
+    auto &cost_map = cost_scratch<Arithmetic>().cost_map;
     {
-        if (room.size < 9)
-        {
-            score -= 100.f;
-            continue;
-        }
-        const auto &room_config = config[room.type];
+        ProfileScope profile(ProfileStage::costmap);
+        fill_costmap<Arithmetic>(map, tables, scoring, cost_map);
+    }
+    const auto room_infos = [&] {
+        ProfileScope profile(ProfileStage::analyze_rooms);
+        return analyze_rooms(map, scratch_tiles, frozen);
+    }();
+    auto *fields = cache != nullptr ? &cache->fields().get<typename Arithmetic::Cost>() : nullptr;
+    if (fields != nullptr)
+    {
+        match_fields<Arithmetic>(map, tables, cost_map, room_infos, *fields);
+    }
 
-        // Size
-        const auto max_room_size = room_config.minimum_size * 4;
-        if (room.size < room_config.minimum_size)
-        {
-            score -= 1000.f;
-        }
-        else if (room.size < max_room_size)
-        {
-            score += static_cast<float>(room.size - room_config.minimum_size) *
-                     room_config.size_scaling;
-        }
+    // A target outside a room's region can never be reached, so a room with no weighted targets
+    // inside its region can skip its distance search altogether
+    std::vector<Bitboard> regions;
+    std::vector<std::size_t> room_regions;
+    find_regions(map, room_infos, regions, room_regions);
 
-        // Aspect ratio
-        score -= static_cast<float>(
-                     std::abs(static_cast<short>(room.width) - static_cast<short>(room.height))) *
-                 10.f;
-        if (room.width < 3 || room.height < 3)
+    // Individual room operations
+    // Each room records the terms it contributes instead of adding them to the score directly, so
+    // the rooms can be scored in any order (or in parallel) and still sum to the same result.
+    std::vector<std::vector<Score>> room_terms(room_infos.size());
+    const auto score_room = [&](std::size_t room_index) {
+        const auto &room = room_infos[room_index];
+        auto &terms = room_terms[room_index];
+        if (!add_shape_terms<Arithmetic>(room, scoring, terms))
         {
-            score -= 100.f;
+            return;
         }
 
-        // Room shape
-        // We calculate the expected area if the room was a rectangle, and any difference between
-        // that and the actual area is considered bad.
-        score -= static_cast<float>(room.width * room.height - static_cast<int>(room.size));
-
         // Distance to other rooms
-        std::vector<float> temp_cost_map(cost_map);
-        for (const auto &coordinate : room.coordinates)
+        const auto &region = regions[room_regions[room_index]];
+        const bool any_target_reachable =
+            std::any_of(room_infos.begin(), room_infos.end(), [&](const RoomInfo &target_room) {
+                return scoring.weight(room.type, target_room.type) != nullptr &&
+                       region.get(target_room.center_x, target_room.center_y);
+            });
+        if (!any_target_reachable)
+        {
+            for (const auto &target_room : room_infos)
+            {
+                if (scoring.weight(room.type, target_room.type) != nullptr)
+                {
+                    terms.push_back(Arithmetic::term(-500.f));
+                }
+            }
+            return;
+        }
+        auto &scratch = cost_scratch<Arithmetic>();
+        auto *distances = &scratch.distances;
         {
-            temp_cost_map[coordinate.second * map.size() + coordinate.first] = 0.f;
+            ProfileScope profile(ProfileStage::distance_map);
+            if (fields == nullptr)
+            {
+                distance_map<Arithmetic>(cost_map, room.spans, map.size(), scratch.distance,
+                                         *distances);
+            }
+            else if (fields->room_fields[room_index] != fields->fields.size())
+            {
+                auto &field = fields->fields[fields->room_fields[room_index]];
+                fields->repaired_tiles[room_index] = repair_distances<Arithmetic>(
+                    fields->cost_map, cost_map, fields->changed_costs, map.size(), field,
+                    scratch.repair);
+                distances = &field.distances;
+            }
+            else
+            {
+                auto &field = fields->fresh[room_index];
+                field.type = room.type;
+                field.spans = room.spans;
+                field.sources = span_mask(room.spans, map.size());
+                distance_map<Arithmetic>(cost_map, room.spans, map.size(), scratch.distance,
+                                         field.distances);
+                distances = &field.distances;
+            }
+            if (fields != nullptr)
+            {
+                fields->used[room_index] = 1;
+            }
         }
-        const auto distances =
-            distance_map(temp_cost_map, room.center_x, room.center_y, map.size());
         for (const auto &target_room : room_infos)
         {
-            const auto weight = config[room.type].weights.find(target_room.type);
-            if (weight != config[room.type].weights.end())
+            const auto *weight = scoring.weight(room.type, target_room.type);
+            if (weight != nullptr)
             {
                 const auto cost =
-                    distances[target_room.center_y * map.size() + target_room.center_x];
-                if (cost == std::numeric_limits<float>::infinity())
+                    (*distances)[target_room.center_y * map.size() + target_room.center_x];
+                if (cost == Arithmetic::unreachable)
                 {
-                    score -= 500;
+                    terms.push_back(Arithmetic::term(-500.f));
                 }
                 else
                 {
-                    score -= cost * weight->second;
+                    terms.push_back(Arithmetic::distance_term(cost, *weight));
                 }
             }
         }
+    };
+
+    if (parallelism.pool != nullptr && parallelism.threads > 1)
+    {
+        parallelism.pool->parallel_for(0, room_infos.size(), score_room, parallelism.threads);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < room_infos.size(); i++)
+        {
+            score_room(i);
+        }
+    }
+    for (const auto &terms : room_terms)
+    {
+        for (const auto term : terms)
+        {
+            score += term;
+        }
     }
 
-    // Global operations
-    // Room count
-    for (int i = 0; i < config.size(); i++)
+    if (fields != nullptr)
     {
-        unsigned int room_count = 0;
-        for (const auto &room : room_infos)
+        auto &statistics = cache->fields().statistics;
+        for (std::size_t i = 0; i < room_infos.size(); i++)
         {
-            if (room.size >= 9 && room.type == i)
+            if (!fields->used[i])
             {
-                room_count++;
+                continue;
+            }
+            if (fields->room_fields[i] != fields->fields.size())
+            {
+                statistics.repaired++;
+                statistics.repaired_tiles += fields->repaired_tiles[i];
+            }
+            else
+            {
+                statistics.searched++;
+            }
+        }
+    }
+
+    add_global_terms<Arithmetic>(map, tables, scoring, room_infos, score);
+    return score;
+}
+
+template <class Arithmetic>
+typename Arithmetic::Score evaluate(const Map &map, const EvaluationTables &tables,
+                                    const EvaluationParallelism &parallelism,
+                                    DistanceCache *cache = nullptr)
+{
+#ifdef RLO_BAKED_CONFIG
+    if (tables.specialized())
+    {
+        return evaluate<Arithmetic>(map, tables, BakedScoring(), parallelism, cache);
+    }
+#endif
+    return evaluate<Arithmetic>(map, tables, RuntimeScoring(tables), parallelism, cache);
+}
+
+float evaluate(const Map &map, const EvaluationTables &tables,
+               const EvaluationParallelism &parallelism)
+{
+    if (tables.arithmetic() == ScoreArithmetic::fixed_point)
+    {
+        return fixed_to_score(evaluate<FixedArithmetic>(map, tables, parallelism));
+    }
+    return evaluate<FloatArithmetic>(map, tables, parallelism);
+}
+
+float evaluate(const Map &map, const EvaluationTables &tables, DistanceCache &cache,
+               const EvaluationParallelism &parallelism)
+{
+    if (tables.arithmetic() == ScoreArithmetic::fixed_point)
+    {
+        return fixed_to_score(evaluate<FixedArithmetic>(map, tables, parallelism, &cache));
+    }
+    return evaluate<FloatArithmetic>(map, tables, parallelism, &cache);
+}
+
+std::int64_t evaluate_fixed(const Map &map, const EvaluationTables &tables,
+                            const EvaluationParallelism &parallelism)
+{
+    return evaluate<FixedArithmetic>(map, tables, parallelism);
+}
+
+PartialEvaluation evaluate_partial(const Map &map, const EvaluationTables &tables)
+{
+    const auto *frozen = tables.frozen_analysis();
+    if (frozen != nullptr && frozen->size != map.size())
+    {
+        throw std::invalid_argument("Map doesn't match the size of the frozen mask");
+    }
+    const RuntimeScoring scoring(tables);
+    const auto room_types = scoring.room_types();
+    const auto room_infos = analyze_rooms(map, scratch_tiles, frozen);
+    std::vector<Bitboard> regions;
+    std::vector<std::size_t> room_regions;
+    find_regions(map, room_infos, regions, room_regions);
+
+    PartialEvaluation result{0.f, std::vector<float>(3 + 2 * room_types, 0.f)};
+    auto &features = result.features;
+    features[0] = 1.f;
+    features[1] = static_cast<float>(std::count(map.data().begin(), map.data().end(), door));
+    std::vector<float> terms;
+    for (std::size_t i = 0; i < room_infos.size(); i++)
+    {
+        const auto &room = room_infos[i];
+        terms.clear();
+        if (add_shape_terms<FloatArithmetic>(room, scoring, terms))
+        {
+            features[3 + room_types + room.type]++;
+            // Targets outside the region get the penalty evaluate() gives unreachable ones
+            const auto &region = regions[room_regions[i]];
+            for (const auto &target_room : room_infos)
+            {
+                const auto *weight = scoring.weight(room.type, target_room.type);
+                if (weight == nullptr)
+                {
+                    continue;
+                }
+                if (!region.get(target_room.center_x, target_room.center_y))
+                {
+                    terms.push_back(-500.f);
+                    continue;
+                }
+                const auto manhattan =
+                    std::abs(static_cast<int>(room.center_x) -
+                             static_cast<int>(target_room.center_x)) +
+                    std::abs(static_cast<int>(room.center_y) -
+                             static_cast<int>(target_room.center_y));
+                features[2]++;
+                features[3 + room.type] += *weight * static_cast<float>(manhattan);
             }
         }
-        if (room_count != config[i].count)
+        for (const auto term : terms)
         {
-            score -= 15000.f * std::abs(static_cast<short>(room_count) -
-                                        static_cast<short>(config[i].count));
+            result.score += term;
         }
     }
+    add_global_terms<FloatArithmetic>(map, tables, scoring, room_infos, result.score);
+    return result;
+}
 
-    // Individual tiles
-    for (const auto &tile : map.data())
+void evaluate_batch(const Map *maps, std::size_t count, const EvaluationTables &tables,
+                    float *scores, const EvaluationParallelism &parallelism)
+{
+    const auto score_map = [&](std::size_t i) { scores[i] = evaluate(maps[i], tables); };
+    if (parallelism.pool != nullptr && parallelism.threads > 1)
+    {
+        parallelism.pool->parallel_for(0, count, score_map, parallelism.threads);
+    }
+    else
     {
-        if (tile == wall)
+        for (std::size_t i = 0; i < count; i++)
         {
-            score -= wall_cost;
+            score_map(i);
         }
-        else if (tile == door)
+    }
+}
+
+std::vector<float> evaluate_file(const std::string &path, unsigned int map_size,
+                                 const EvaluationTables &tables,
+                                 const EvaluationParallelism &parallelism)
+{
+    const MappedFile file(path);
+    const std::size_t tiles_per_map = std::size_t{map_size} * map_size;
+    if (tiles_per_map == 0 || file.size() % tiles_per_map != 0)
+    {
+        throw std::runtime_error(path + " doesn't hold a whole number of " +
+                                 std::to_string(map_size) + "x" + std::to_string(map_size) +
+                                 " maps");
+    }
+    check_tiles(file.data(), file.size(), tables.config());
+
+    // Maps are built as views straight onto the mapping a chunk at a time, so memory use stays
+    // flat however big the file is
+    constexpr std::size_t chunk_size = 256;
+    const auto count = file.size() / tiles_per_map;
+    std::vector<float> scores(count);
+    std::vector<Map> chunk;
+    for (std::size_t begin = 0; begin < count; begin += chunk_size)
+    {
+        chunk.clear();
+        const auto end = std::min(count, begin + chunk_size);
+        for (std::size_t i = begin; i < end; i++)
         {
-            score -= door_cost;
+            chunk.emplace_back(map_size, TileSpan{file.data() + i * tiles_per_map, tiles_per_map});
         }
+        evaluate_batch(chunk.data(), chunk.size(), tables, scores.data() + begin, parallelism);
     }
-
-    return score;
+    return scores;
 }
 
 TEST_CASE("analyze_rooms()")
@@ -325,6 +1396,24 @@ TEST_CASE("analyze_rooms()")
         CHECK(room_info[0].type == 25);
         CHECK(room_info[0].center_x == 2);
         CHECK(room_info[0].center_y == 4);
+        CHECK(room_info[0].spans.size() == 2);
+    }
+
+    SUBCASE("Centers concave rooms on a tile inside the room")
+    {
+        // An L-shaped room whose centroid (1, 1) is floor
+        std::vector<unsigned char> data(25, floor);
+        for (const auto index : {0, 1, 2, 3, 5, 10, 15})
+        {
+            data[static_cast<std::size_t>(index)] = 3;
+        }
+        const auto room_info = analyze_rooms(Map(data));
+
+        REQUIRE(room_info.size() == 1);
+        CHECK(room_info[0].size == 7);
+        CHECK(room_info[0].width == 4);
+        CHECK(room_info[0].height == 4);
+        CHECK(data[room_info[0].center_y * 5 + room_info[0].center_x] == 3);
     }
 }
 
@@ -375,4 +1464,234 @@ TEST_CASE("create_costmap()")
         CHECK(cost_map[3 * 10 + 2] == 7.f);
     }
 }
+
+namespace
+{
+// Nodes of random types scattered over a 100 x 100 map, for tests that want many different rooms
+std::vector<Node> random_nodes(std::size_t count, const std::vector<RoomConfig> &config, Rng &rng)
+{
+    std::vector<Node> nodes;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        nodes.push_back({rng.below(100),
+                         rng.below(100),
+                         static_cast<unsigned char>(rng.index(config.size())),
+                         {rng.below(100), rng.below(100), rng.below(100), rng.below(100)}});
+    }
+    return nodes;
+}
+}
+
+TEST_CASE("evaluate()")
+{
+    SUBCASE("Scoring rooms in parallel gives exactly the same result as scoring them serially")
+    {
+        const auto config = read_config_from_file("config.yml");
+        Rng rng(0);
+        const Map map(100, random_nodes(100, config, rng));
+        ThreadPool pool(4);
+
+        CHECK(evaluate(map, config, {&pool, 4}) == evaluate(map, config));
+    }
+
+    SUBCASE("Batches score every map the same as scoring it alone")
+    {
+        const auto config = read_config_from_file("config.yml");
+        const EvaluationTables tables(config);
+        Rng rng(1);
+        std::vector<Map> maps;
+        std::vector<unsigned char> file_contents;
+        for (int i = 0; i < 6; i++)
+        {
+            maps.emplace_back(100, random_nodes(30, config, rng));
+            file_contents.insert(file_contents.end(), maps.back().data().begin(),
+                                 maps.back().data().end());
+        }
+        ThreadPool pool(3);
+        std::vector<float> scores(maps.size());
+        evaluate_batch(maps.data(), maps.size(), tables, scores.data(), {&pool, 3});
+
+        const auto path = (std::filesystem::temp_directory_path() / "rlo_maps_test.bin").string();
+        std::ofstream(path, std::ios::binary)
+            .write(reinterpret_cast<const char *>(file_contents.data()),
+                   static_cast<std::streamsize>(file_contents.size()));
+        const auto file_scores = evaluate_file(path, 100, tables, {&pool, 3});
+        std::filesystem::remove(path);
+
+        REQUIRE(file_scores.size() == maps.size());
+        for (std::size_t i = 0; i < maps.size(); i++)
+        {
+            CHECK(scores[i] == evaluate(maps[i], config));
+            CHECK(file_scores[i] == scores[i]);
+        }
+        CHECK_THROWS(evaluate_file("config.yml", 100, tables));
+
+        // A room type the config doesn't have would be looked up past its end
+        auto corrupt = file_contents;
+        for (unsigned int y = 40; y < 60; y++)
+        {
+            std::fill(corrupt.begin() + y * 100 + 40, corrupt.begin() + y * 100 + 60, 200);
+        }
+        std::ofstream(path, std::ios::binary)
+            .write(reinterpret_cast<const char *>(corrupt.data()),
+                   static_cast<std::streamsize>(corrupt.size()));
+        CHECK_THROWS(evaluate_file(path, 100, tables));
+        std::filesystem::remove(path);
+    }
+
+    SUBCASE("Tables built for a frozen mask score its maps the same as plain tables")
+    {
+        const auto config = read_config_from_file("config.yml");
+        // A walled-in room with a door, which no layout can change, and a strip of room tiles
+        // out in the open that layouts can extend
+        std::vector<unsigned char> frozen_tiles(100 * 100, floor);
+        for (unsigned int y = 10; y < 20; y++)
+        {
+            for (unsigned int x = 10; x < 20; x++)
+            {
+                const bool edge = x == 10 || x == 19 || y == 10 || y == 19;
+                frozen_tiles[y * 100 + x] = edge ? wall : 0;
+            }
+        }
+        frozen_tiles[15 * 100 + 10] = door;
+        std::fill(frozen_tiles.begin() + 50 * 100 + 50, frozen_tiles.begin() + 50 * 100 + 56, 1);
+        const FrozenMask frozen(100, {frozen_tiles.data(), frozen_tiles.size()});
+        const EvaluationTables plain(config);
+        const EvaluationTables tables(config, &frozen);
+
+        const auto config_copy = config;
+        const EvaluationTables shared(config_copy, tables);
+        CHECK(&shared.config() == &config_copy);
+        CHECK(shared.frozen_analysis() == tables.frozen_analysis());
+
+        REQUIRE(tables.frozen_analysis()->sealed_rooms.size() == 1);
+        CHECK(tables.frozen_analysis()->sealed_rooms.front().size == 64);
+        CHECK(tables.frozen_analysis()->free_tiles.size() == 100 * 100 - 100 - 6);
+
+        Rng rng(2);
+        for (int i = 0; i < 4; i++)
+        {
+            const Map map(100, random_nodes(40, config, rng), &frozen);
+
+            CHECK(evaluate(map, tables) == evaluate(map, plain));
+            CHECK(evaluate_fixed(map, tables) == evaluate_fixed(map, plain));
+        }
+        CHECK_THROWS(evaluate(Map(10, std::vector<Room>{}), tables));
+    }
+
+    SUBCASE("Fixed point scores are close to floating point ones and exactly reproducible")
+    {
+        const auto config = read_config_from_file("config.yml");
+        const EvaluationTables tables(config, nullptr, ScoreArithmetic::fixed_point);
+        const EvaluationTables float_tables(config);
+        ThreadPool pool(4);
+        Rng rng(3);
+        for (int sample = 0; sample < 10; sample++)
+        {
+            const Map map(100, random_nodes(60, config, rng));
+            const auto fixed = evaluate_fixed(map, tables);
+
+            CHECK(evaluate_fixed(map, tables, {&pool, 4}) == fixed);
+            CHECK(evaluate_fixed(map, float_tables) == fixed);
+            CHECK(evaluate(map, tables) == fixed_to_score(fixed));
+            CHECK(std::abs(fixed_to_score(fixed) - evaluate(map, float_tables)) <=
+                  1e-4f * std::abs(evaluate(map, float_tables)) + 1.f);
+        }
+    }
+
+    SUBCASE("Partial evaluations leave out exactly the distance terms")
+    {
+        auto config = read_config_from_file("config.yml");
+        Rng rng(4);
+        std::vector<Map> maps;
+        for (int sample = 0; sample < 5; sample++)
+        {
+            maps.emplace_back(100, random_nodes(40, config, rng));
+        }
+
+        const EvaluationTables tables(config);
+        for (const auto &map : maps)
+        {
+            const auto partial = evaluate_partial(map, tables);
+
+            REQUIRE(partial.features.size() == 3 + 2 * config.size());
+            CHECK(partial.features[0] == 1.f);
+            CHECK(partial.features[2] > 0.f);
+            // Every weight in the config is positive, so the distances only take away
+            CHECK(partial.score > evaluate(map, tables));
+        }
+
+        // With no weights there are no distances, and the terms are added in the same order
+        for (auto &room : config)
+        {
+            room.weights.clear();
+        }
+        const EvaluationTables unweighted(config);
+        for (const auto &map : maps)
+        {
+            CHECK(evaluate_partial(map, unweighted).score == evaluate(map, unweighted));
+        }
+    }
+
+    SUBCASE("Repaired distance fields score exactly like fresh searches")
+    {
+        const auto config = read_config_from_file("config.yml");
+        ThreadPool pool(4);
+        for (const auto arithmetic :
+             {ScoreArithmetic::floating_point, ScoreArithmetic::fixed_point})
+        {
+            const EvaluationTables tables(config, nullptr, arithmetic);
+            DistanceCache cache;
+            Rng rng(5);
+            auto nodes = random_nodes(40, config, rng);
+            // Small moves, like the optimizer's, with every third one rejected
+            for (unsigned int step = 0; step < 60; step++)
+            {
+                auto candidate = nodes;
+                auto &node = candidate[rng.index(candidate.size())];
+                const auto nudge = [&](unsigned int value) {
+                    return std::min(99u, std::max(2u, value + rng.below(5)) - 2);
+                };
+                node.x = nudge(node.x);
+                node.y = nudge(node.y);
+                node.door_positions[rng.below(4)] = rng.below(100);
+                const Map map(100, candidate);
+                const auto score = step % 2 == 0 ? evaluate(map, tables, cache)
+                                                 : evaluate(map, tables, cache, {&pool, 4});
+
+                CHECK(score == evaluate(map, tables));
+                if (step % 3 != 0)
+                {
+                    cache.accept();
+                    nodes = std::move(candidate);
+                }
+            }
+            const auto &statistics = cache.statistics();
+            CHECK(statistics.repaired > statistics.searched);
+            // Each repair touches a fraction of the map where a search would settle all of it
+            CHECK(statistics.repaired_tiles < statistics.repaired * 100 * 100 / 4);
+        }
+    }
+
+#ifdef RLO_BAKED_CONFIG
+    SUBCASE("The baked tables score exactly like the runtime ones")
+    {
+        const auto config = read_config_from_file("config.yml");
+        const EvaluationTables tables(config);
+        // Builds may be specialized on some other config, leaving nothing to compare here
+        Rng rng(2);
+        for (int sample = 0; tables.specialized() && sample < 20; sample++)
+        {
+            const Map map(100, random_nodes(50, config, rng));
+
+            CHECK(evaluate<FloatArithmetic>(map, tables, BakedScoring(), {}, nullptr) ==
+                  evaluate<FloatArithmetic>(map, tables, RuntimeScoring(tables), {}, nullptr));
+        }
+
+        auto changed = config;
+        changed[0].count++;
+        CHECK(!EvaluationTables(changed).specialized());
+    }
+#endif
+}
 }
\ No newline at end of file
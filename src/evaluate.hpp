@@ -1,11 +1,177 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "config.hpp"
+#include "frozen.hpp"
 #include "map.hpp"
+#include "thread_pool.hpp"
 
 namespace rlo
 {
-float evaluate(const Map &map, const std::vector<RoomConfig> &config);
+// Subtracted from the score for every door and wall tile
+constexpr float door_cost = 1.f;
+constexpr float wall_cost = 0.1f;
+// What crossing a door adds to a path
+constexpr float door_move_cost = 25.f;
+
+// How evaluate() adds a score up. Floating point sums the terms as floats, so the total depends
+// on the order they're added in. Fixed point rounds every movement cost to a multiple of
+// 2^-fixed_cost_bits, every weight to 2^-fixed_weight_bits and every term to 2^-fixed_score_bits
+// and sums them as 64-bit integers, which comes out exactly the same in any order.
+enum class ScoreArithmetic
+{
+    floating_point,
+    fixed_point
+};
+constexpr int fixed_cost_bits = 10;
+constexpr int fixed_weight_bits = 20;
+// A distance times a weight lands on exactly this scale
+constexpr int fixed_score_bits = fixed_cost_bits + fixed_weight_bits;
+
+inline float fixed_to_score(std::int64_t fixed)
+{
+    return static_cast<float>(std::ldexp(static_cast<double>(fixed), -fixed_score_bits));
+}
+
+// How much of a pool a single evaluation may use for its per-room distance searches. The default
+// scores everything on the calling thread.
+struct EvaluationParallelism
+{
+    ThreadPool *pool = nullptr;
+    unsigned int threads = 1;
+};
+
+// Worked out once from a frozen mask and reused by every evaluation, defined in evaluate.cpp
+struct FrozenAnalysis;
+
+// Lookups derived from a config so evaluations don't search it or its weight maps. Build one
+// per config and share it between all the evaluations using that config, which must outlive it.
+// With a frozen mask (which must outlive it too) the costs and rooms of the frozen tiles are also
+// worked out up front. Those tables may then only score maps rasterized with that mask.
+class EvaluationTables
+{
+  private:
+    const std::vector<RoomConfig> *m_config;
+    const FrozenMask *m_frozen;
+    ScoreArithmetic m_arithmetic;
+    std::shared_ptr<const FrozenAnalysis> m_frozen_analysis;
+    std::array<float, 256> m_movement_costs;
+    // Subtracted from the score for every tile of each kind
+    std::array<float, 256> m_tile_penalties;
+    // Indexed by room type * 256 + target type
+    std::vector<bool> m_has_weight;
+    std::vector<float> m_weights;
+    bool m_specialized = false;
+
+  public:
+    explicit EvaluationTables(const std::vector<RoomConfig> &config,
+                              const FrozenMask *frozen = nullptr,
+                              ScoreArithmetic arithmetic = ScoreArithmetic::floating_point);
+    // The same tables over another copy of the same config, sharing the frozen analysis rather
+    // than working it out again
+    EvaluationTables(const std::vector<RoomConfig> &config, const EvaluationTables &tables);
+
+    inline const std::vector<RoomConfig> &config() const { return *m_config; }
+    inline const FrozenMask *frozen() const { return m_frozen; }
+    inline ScoreArithmetic arithmetic() const { return m_arithmetic; }
+    inline const FrozenAnalysis *frozen_analysis() const { return m_frozen_analysis.get(); }
+    inline float movement_cost(unsigned char tile) const { return m_movement_costs[tile]; }
+    inline float tile_penalty(unsigned char tile) const { return m_tile_penalties[tile]; }
+    // Whether this is the config the build was specialized on with RLO_BAKED_CONFIG, so evaluate()
+    // can read it from compile-time tables instead
+    inline bool specialized() const { return m_specialized; }
+    // How strongly rooms of `type` want to be near rooms of `target`, or nullptr if they don't
+    inline const float *weight(unsigned char type, unsigned char target) const
+    {
+        const auto index = std::size_t{type} * 256 + target;
+        return index < m_weights.size() && m_has_weight[index] ? &m_weights[index] : nullptr;
+    }
+};
+
+float evaluate(const Map &map, const std::vector<RoomConfig> &config,
+               const EvaluationParallelism &parallelism = {});
+float evaluate(const Map &map, const EvaluationTables &tables,
+               const EvaluationParallelism &parallelism = {});
+// The fixed point score of the map, in units of 2^-fixed_score_bits, whichever arithmetic the
+// tables are set to
+std::int64_t evaluate_fixed(const Map &map, const EvaluationTables &tables,
+                            const EvaluationParallelism &parallelism = {});
+
+// The per-room distance fields a DistanceCache keeps, defined in evaluate.cpp
+struct DistanceFields;
+
+struct DistanceCacheStatistics
+{
+    // Fields repaired from the accepted map's, and fields searched from scratch
+    std::size_t repaired = 0;
+    std::size_t searched = 0;
+    // Distances the repairs reset or settled, where a search from scratch settles every tile
+    std::size_t repaired_tiles = 0;
+
+    void merge(const DistanceCacheStatistics &other);
+};
+
+// Keeps the distance field of every room of the last accepted map. The next map evaluated with
+// it has each room's field repaired from the field of the same room on the accepted map: the
+// tiles whose distances ran through a tile that changed cost or stopped being part of the room
+// are reset and searched again from their neighbours, which costs time in proportion to the area
+// the changes affect rather than to the whole map. Rooms that can't be matched, or that changed
+// too much, are searched from scratch. Either way the scores are exactly those of evaluate().
+// One cache serves one thread of evaluations at a time.
+class DistanceCache
+{
+  private:
+    std::unique_ptr<DistanceFields> m_fields;
+
+  public:
+    DistanceCache();
+    ~DistanceCache();
+    DistanceCache(DistanceCache &&other) noexcept;
+    DistanceCache &operator=(DistanceCache &&other) noexcept;
+
+    // Makes the fields of the map last evaluated with the cache the ones the next are repaired
+    // from. Otherwise the next evaluation starts by undoing the last one's repairs.
+    void accept();
+    const DistanceCacheStatistics &statistics() const;
+    inline DistanceFields &fields() { return *m_fields; }
+};
+
+// Scores exactly like evaluate() without a cache
+float evaluate(const Map &map, const EvaluationTables &tables, DistanceCache &cache,
+               const EvaluationParallelism &parallelism = {});
+
+// Everything evaluate() adds up except the distances between rooms, which is all but the
+// per-room distance searches and so a small fraction of the cost
+struct PartialEvaluation
+{
+    // The full score without the distance terms of pairs of rooms that can reach each other
+    float score;
+    // Describes the missing distance terms, for predicting them: a constant 1, the number of door
+    // tiles, the number of weighted pairs that can reach each other, then for each room type the
+    // sum of weight times Manhattan distance between the centers of those pairs, then the number
+    // of rooms of each type big enough to count
+    std::vector<float> features;
+};
+
+// Always scores in floating point, whatever arithmetic the tables are set to
+PartialEvaluation evaluate_partial(const Map &map, const EvaluationTables &tables);
+
+// Scores `count` maps into `scores`, one map per thread. Each thread keeps its working memory
+// between maps, so this runs at the cost of the evaluations themselves.
+void evaluate_batch(const Map *maps, std::size_t count, const EvaluationTables &tables,
+                    float *scores, const EvaluationParallelism &parallelism = {});
+
+// Scores a file of back-to-back map_size * map_size tile buffers, memory-mapping it and viewing
+// each map in place rather than reading it into memory. Throws if any tile isn't one the tables'
+// config knows.
+std::vector<float> evaluate_file(const std::string &path, unsigned int map_size,
+                                 const EvaluationTables &tables,
+                                 const EvaluationParallelism &parallelism = {});
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "frozen.hpp"
+#include "bitmap.hpp"
+#include "config.hpp"
+#include "import.hpp"
+#include "map.hpp"
+#include "utils.hpp"
+
+namespace rlo
+{
+FrozenMask::FrozenMask(unsigned int size, TileSpan tiles)
+    : m_size(size), m_mask(size), m_tiles(std::size_t{size} * size, floor)
+{
+    if (tiles.size() < m_tiles.size())
+    {
+        throw std::invalid_argument("Tile buffer is smaller than the frozen mask");
+    }
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            const auto index = y * size + x;
+            if (tiles[index] != floor)
+            {
+                m_mask.set(x, y);
+                m_tiles[index] = tiles[index];
+                m_frozen_indices.push_back(index);
+            }
+        }
+    }
+}
+
+void FrozenMask::apply(std::vector<unsigned char> &tiles) const
+{
+    if (tiles.size() != m_tiles.size())
+    {
+        throw std::invalid_argument("Frozen mask is " + std::to_string(m_size) + "x" +
+                                    std::to_string(m_size) + " but the map isn't");
+    }
+    for (const auto index : m_frozen_indices)
+    {
+        tiles[index] = m_tiles[index];
+    }
+}
+
+FrozenMask frozen_mask_from_bitmap(const bitmap_image &image,
+                                   const std::vector<RoomConfig> &config)
+{
+    const auto map = map_from_bitmap(image, config);
+    return FrozenMask(map.size(), map.data());
+}
+
+FrozenMask read_frozen_mask(const std::string &path, unsigned int size,
+                            const std::vector<RoomConfig> &config)
+{
+    const auto map = read_map(path, size, config);
+    return FrozenMask(map.size(), map.data());
+}
+
+TEST_CASE("FrozenMask")
+{
+    const auto config = read_config_from_file("config.yml");
+    std::vector<unsigned char> tiles(25, floor);
+    tiles[0] = wall;
+    tiles[7] = door;
+    tiles[13] = 1;
+    const FrozenMask mask(5, {tiles.data(), tiles.size()});
+
+    SUBCASE("Freezes every tile that isn't floor")
+    {
+        CHECK(mask.count() == 3);
+        CHECK(mask.contains(0, 0));
+        CHECK(mask.contains(2, 1));
+        CHECK(mask.contains(3, 2));
+        CHECK(!mask.contains(1, 0));
+        CHECK(!mask.contains(5, 0));
+    }
+
+    SUBCASE("Only overwrites frozen tiles")
+    {
+        std::vector<unsigned char> map(25, 2);
+        mask.apply(map);
+
+        CHECK(map[0] == wall);
+        CHECK(map[7] == door);
+        CHECK(map[13] == 1);
+        CHECK(std::count(map.begin(), map.end(), 2) == 22);
+    }
+
+    SUBCASE("Reads the colours maps are saved in")
+    {
+        const auto image = Map(tiles).to_bitmap(config_to_color_map(config));
+        const auto from_image = frozen_mask_from_bitmap(image, config);
+
+        CHECK(from_image.mask() == mask.mask());
+        CHECK(std::equal(from_image.tiles().begin(), from_image.tiles().end(),
+                         mask.tiles().begin()));
+    }
+
+    SUBCASE("Rejects colours that aren't in the config")
+    {
+        bitmap_image image(2, 2);
+        image.set_all_channels(255, 255, 255);
+        image.set_pixel(1, 1, rgb_t{1, 2, 3});
+
+        CHECK_THROWS(frozen_mask_from_bitmap(image, config));
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bitboard.hpp"
+#include "bitmap.hpp"
+#include "config.hpp"
+#include "map.hpp"
+
+namespace rlo
+{
+// Tiles the optimizer has to leave alone, like buildings that already exist or mountains.
+// Rasterized maps always keep the frozen tiles' values, and mutations never move a node or room
+// onto one.
+class FrozenMask
+{
+  private:
+    unsigned int m_size;
+    Bitboard m_mask;
+    // Every tile of the map, with the ones that aren't frozen left as floor
+    std::vector<unsigned char> m_tiles;
+    std::vector<unsigned int> m_frozen_indices;
+
+  public:
+    // Freezes every tile of a size * size buffer that isn't floor, at its value in the buffer
+    FrozenMask(unsigned int size, TileSpan tiles);
+
+    // Writes the frozen tiles over a size * size buffer, leaving the rest alone
+    void apply(std::vector<unsigned char> &tiles) const;
+
+    inline unsigned int size() const { return m_size; }
+    inline const Bitboard &mask() const { return m_mask; }
+    inline TileSpan tiles() const { return {m_tiles.data(), m_tiles.size()}; }
+    inline std::size_t count() const { return m_frozen_indices.size(); }
+    inline bool contains(unsigned int x, unsigned int y) const
+    {
+        return x < m_size && y < m_size && m_mask.get(x, y);
+    }
+};
+
+// Reads a mask drawn in the colours maps are saved in. White (floor) pixels are left free, and
+// any colour that isn't in the config is an error.
+FrozenMask frozen_mask_from_bitmap(const bitmap_image &image,
+                                   const std::vector<RoomConfig> &config);
+
+// Loads a .bmp with frozen_mask_from_bitmap(), or any other file as raw size * size tiles
+FrozenMask read_frozen_mask(const std::string &path, unsigned int size,
+                            const std::vector<RoomConfig> &config);
+}
\ No newline at end of file
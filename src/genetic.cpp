@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "genetic.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "frozen.hpp"
+#include "import.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+namespace rlo
+{
+struct Individual
+{
+    std::vector<Node> nodes;
+    float score;
+};
+
+std::vector<Node> crossover(const std::vector<Node> &a, const std::vector<Node> &b, Rng &rng)
+{
+    const bool vertical_cut = rng.below(2);
+    const auto cut = 1 + rng.below(map_size - 1);
+    const auto coordinate = [&](const Node &node) { return vertical_cut ? node.x : node.y; };
+
+    std::vector<Node> child;
+    std::copy_if(a.begin(), a.end(), std::back_inserter(child),
+                 [&](const Node &node) { return coordinate(node) < cut; });
+    std::copy_if(b.begin(), b.end(), std::back_inserter(child),
+                 [&](const Node &node) { return coordinate(node) >= cut; });
+    if (child.empty())
+    {
+        return a;
+    }
+    return child;
+}
+
+std::size_t tournament(const std::vector<Individual> &population, unsigned int size, Rng &rng)
+{
+    auto winner = rng.index(population.size());
+    for (unsigned int i = 1; i < size; i++)
+    {
+        const auto challenger = rng.index(population.size());
+        if (population[challenger].score > population[winner].score)
+        {
+            winner = challenger;
+        }
+    }
+    return winner;
+}
+
+OptimizationResult<std::vector<Node>> run_genetic(const std::vector<RoomConfig> &config,
+                                                  const GeneticOptions &options)
+{
+    const auto start_time = std::chrono::steady_clock::now();
+    auto &pool = ThreadPool::shared();
+    const auto threads = options.threads == 0 ? pool.size() + 1 : options.threads;
+    const EvaluationParallelism parallelism{&pool, options.evaluation_threads};
+    const auto *frozen = options.frozen.get();
+    const EvaluationTables tables(config, frozen, options.arithmetic);
+    Rng rng(options.seed == 0 ? random_seed() : options.seed);
+
+    const auto color_map = config_to_color_map(config);
+
+    // Offspring are bred serially, which is cheap, then scored as a single parallel batch
+    std::atomic<std::size_t> evaluations = 0;
+    const auto evaluate_all = [&](std::vector<Individual> &individuals, std::size_t begin) {
+        pool.parallel_for(
+            begin, individuals.size(),
+            [&](std::size_t i) {
+                individuals[i].score =
+                    evaluate(Map(map_size, individuals[i].nodes, frozen), tables, parallelism);
+            },
+            threads);
+        evaluations += individuals.size() - begin;
+    };
+    const auto by_score = [](const Individual &lhs, const Individual &rhs) {
+        return lhs.score > rhs.score;
+    };
+
+    std::vector<Individual> population;
+    for (unsigned int i = 0; i < std::max(options.population, 2u); i++)
+    {
+        population.push_back({generate_random_tree(config, rng, frozen), 0.f});
+    }
+    evaluate_all(population, 0);
+    const auto elites = std::min<std::size_t>(options.elites, population.size() - 1);
+
+    for (unsigned int generation = 0; generation < options.generations; generation++)
+    {
+        std::sort(population.begin(), population.end(), by_score);
+
+        std::cout << std::to_string(static_cast<float>(generation) /
+                                    static_cast<float>(options.generations) * 100.f)
+                  << "%\n";
+        std::cout << "Generation: " << std::to_string(generation) << "\n";
+        std::cout << "Score: " << std::to_string(population.front().score) << "\n";
+        std::cout << "---\n";
+        const auto bmp = Map(map_size, population.front().nodes, frozen).to_bitmap(color_map);
+        bmp.save_image(options.output_directory + "/" + std::to_string(generation) + ".bmp");
+
+        std::vector<Individual> next(population.begin(), population.begin() + elites);
+        while (next.size() < population.size())
+        {
+            const auto &parent_a = population[tournament(population, options.tournament_size, rng)];
+            auto child = parent_a.nodes;
+            // Both parents keep their nodes off frozen tiles, so any splice of them does too
+            if (rng.uniform() < options.crossover_rate)
+            {
+                const auto &parent_b =
+                    population[tournament(population, options.tournament_size, rng)];
+                child = crossover(parent_a.nodes, parent_b.nodes, rng);
+            }
+            const auto number_of_permutations = 1 + rng.below(3);
+            for (unsigned int i = 0; i < number_of_permutations; i++)
+            {
+                child = permute(child, config, rng, frozen);
+            }
+            next.push_back({std::move(child), 0.f});
+        }
+        evaluate_all(next, elites);
+        population = std::move(next);
+    }
+
+    std::sort(population.begin(), population.end(), by_score);
+    std::cout << "100%\n";
+    std::cout << "Score: " << std::to_string(population.front().score) << "\n";
+    std::cout << "---\n";
+    const auto bmp = Map(map_size, population.front().nodes, frozen).to_bitmap(color_map);
+    bmp.save_image(options.output_directory + "/final.bmp");
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    return {population.front().nodes, population.front().score, evaluations.load(),
+            elapsed.count()};
+}
+
+TEST_CASE("crossover()")
+{
+    Rng rng(0);
+    // Every node of a sits in the top left corner and every node of b in the bottom right, so
+    // whichever way the cut goes each side only contributes from its own half
+    std::vector<Node> a(10, Node{0, 0, 1, {0, 0, 0, 0}});
+    std::vector<Node> b(10, Node{99, 99, 2, {0, 0, 0, 0}});
+
+    SUBCASE("Takes nodes before the cut from the first parent and after it from the second")
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            const auto child = crossover(a, b, rng);
+
+            CHECK(child.size() == 20);
+            CHECK(std::count_if(child.begin(), child.end(),
+                                [](const Node &node) { return node.type == 1; }) == 10);
+        }
+    }
+
+    SUBCASE("Falls back to the first parent when the cut leaves nothing")
+    {
+        const auto child = crossover(b, a, rng);
+
+        CHECK(child.size() == b.size());
+        CHECK(child.front().type == 2);
+    }
+}
+
+TEST_CASE("run_genetic()")
+{
+    const auto config = read_config_from_file("config.yml");
+    const auto directory = std::filesystem::temp_directory_path();
+    GeneticOptions options;
+    options.population = 4;
+    options.generations = 1;
+    options.output_directory = directory.string();
+    options.seed = 7;
+
+    const auto result = run_genetic(config, options);
+    const auto best = Map(map_size, result.best);
+    const auto again = run_genetic(config, options);
+
+    // Four founders, then the two offspring bred alongside the two elites
+    CHECK(result.evaluations == 6);
+    CHECK(result.score == evaluate(best, EvaluationTables(config)));
+    CHECK(count_mismatches(read_map((directory / "final.bmp").string(), map_size, config), best) ==
+          0);
+    // The same seed breeds the same population
+    CHECK(again.score == result.score);
+    CHECK(count_mismatches(Map(map_size, again.best), best) == 0);
+
+    // A frozen block of wall in the top left corner survives breeding
+    std::vector<unsigned char> tiles(map_size * map_size, floor);
+    for (unsigned int y = 0; y < 20; y++)
+    {
+        std::fill(tiles.begin() + y * map_size, tiles.begin() + y * map_size + 20, wall);
+    }
+    options.frozen = std::make_shared<FrozenMask>(map_size, TileSpan{tiles.data(), tiles.size()});
+    const auto frozen_result = run_genetic(config, options);
+    const auto frozen_best = Map(map_size, frozen_result.best, options.frozen.get());
+
+    CHECK(std::equal(frozen_best.data().begin(), frozen_best.data().end(), tiles.begin(),
+                     [](unsigned char tile, unsigned char frozen_tile) {
+                         return frozen_tile == floor || tile == frozen_tile;
+                     }));
+    CHECK(frozen_result.score ==
+          evaluate(frozen_best, EvaluationTables(config, options.frozen.get())));
+    std::filesystem::remove(directory / "0.bmp");
+    std::filesystem::remove(directory / "final.bmp");
+}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "frozen.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+
+namespace rlo
+{
+struct GeneticOptions
+{
+    unsigned int population = 64;
+    unsigned int generations = 200;
+    unsigned int tournament_size = 3;
+    // The best few individuals are copied into the next generation unchanged
+    unsigned int elites = 2;
+    double crossover_rate = 0.9;
+    // Threads used to evaluate each generation's offspring as one batch
+    unsigned int threads = 0;
+    // Threads each evaluation may use for its per-room distance searches, borrowed from workers
+    // the batch leaves idle
+    unsigned int evaluation_threads = 1;
+    ScoreArithmetic arithmetic = ScoreArithmetic::floating_point;
+    // Seeds breeding and the founding population; 0 picks a random seed
+    std::uint64_t seed = 0;
+    // Where the per-generation snapshots and final.bmp are saved. It must already exist.
+    std::string output_directory = "output";
+    // Tiles every individual keeps as they are. It must be map_size across.
+    std::shared_ptr<const FrozenMask> frozen;
+};
+
+// Splices two K-D trees along a random axis-aligned line: nodes on one side come from `a`, nodes
+// on the other from `b`. Because make_tree() splits space the same way, whole subtrees of rooms
+// tend to survive the cut intact.
+std::vector<Node> crossover(const std::vector<Node> &a, const std::vector<Node> &b, Rng &rng);
+
+// Returns the best individual of the last generation
+OptimizationResult<std::vector<Node>> run_genetic(const std::vector<RoomConfig> &config,
+                                                  const GeneticOptions &options = {});
+}
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "import.hpp"
+#include "bitboard.hpp"
+#include "bitmap.hpp"
+#include "config.hpp"
+#include "frozen.hpp"
+#include "map.hpp"
+#include "mapped_file.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+#include "tests.hpp"
+#include "utils.hpp"
+
+namespace rlo
+{
+namespace
+{
+// A 4-connected patch of tiles of one kind
+struct Component
+{
+    unsigned char type;
+    std::size_t size;
+    unsigned int min_x;
+    unsigned int min_y;
+    unsigned int max_x;
+    unsigned int max_y;
+    // The component's own tile closest to its centroid
+    unsigned int center_x;
+    unsigned int center_y;
+};
+
+std::vector<Component> find_components(const Bitboard &mask, unsigned char type)
+{
+    std::vector<Component> components;
+    auto remaining = mask;
+    const auto size = mask.size();
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            if (!remaining.get(x, y))
+            {
+                continue;
+            }
+            const auto tiles = remaining.flood_fill(x, y);
+            remaining &= ~tiles;
+
+            Component component{type, 0, size, size, 0, 0, 0, 0};
+            double x_sum = 0;
+            double y_sum = 0;
+            for (unsigned int ty = 0; ty < size; ty++)
+            {
+                for (unsigned int tx = 0; tx < size; tx++)
+                {
+                    if (tiles.get(tx, ty))
+                    {
+                        component.size++;
+                        component.min_x = std::min(component.min_x, tx);
+                        component.min_y = std::min(component.min_y, ty);
+                        component.max_x = std::max(component.max_x, tx);
+                        component.max_y = std::max(component.max_y, ty);
+                        x_sum += tx;
+                        y_sum += ty;
+                    }
+                }
+            }
+            const auto centroid_x = x_sum / static_cast<double>(component.size);
+            const auto centroid_y = y_sum / static_cast<double>(component.size);
+            double closest = std::numeric_limits<double>::infinity();
+            for (unsigned int ty = component.min_y; ty <= component.max_y; ty++)
+            {
+                for (unsigned int tx = component.min_x; tx <= component.max_x; tx++)
+                {
+                    const auto distance = (tx - centroid_x) * (tx - centroid_x) +
+                                          (ty - centroid_y) * (ty - centroid_y);
+                    if (tiles.get(tx, ty) && distance < closest)
+                    {
+                        closest = distance;
+                        component.center_x = tx;
+                        component.center_y = ty;
+                    }
+                }
+            }
+            components.push_back(component);
+        }
+    }
+    return components;
+}
+
+// Rooms under `frozen` are already there on any map it's applied to
+std::vector<Component> find_rooms(const Map &map, const FrozenMask *frozen = nullptr)
+{
+    std::vector<Component> rooms;
+    for (unsigned int type = 0; type < floor; type++)
+    {
+        auto mask = map.room_mask(static_cast<unsigned char>(type));
+        if (frozen != nullptr)
+        {
+            mask &= ~frozen->mask();
+        }
+        if (mask.any())
+        {
+            const auto components = find_components(mask, static_cast<unsigned char>(type));
+            rooms.insert(rooms.end(), components.begin(), components.end());
+        }
+    }
+    return rooms;
+}
+}
+
+Map map_from_bitmap(const bitmap_image &image, const std::vector<RoomConfig> &config)
+{
+    if (image.width() != image.height())
+    {
+        throw std::invalid_argument("Map images must be square");
+    }
+    const auto color_map = config_to_color_map(config);
+    const auto size = image.width();
+    std::vector<unsigned char> tiles(std::size_t{size} * size);
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            const auto pixel = image.get_pixel(x, y);
+            const auto match =
+                std::find_if(color_map.begin(), color_map.end(),
+                             [&](const auto &entry) { return entry.second == pixel; });
+            if (match == color_map.end())
+            {
+                throw std::runtime_error("Pixel (" + std::to_string(x) + ", " + std::to_string(y) +
+                                         ") isn't a colour from the config");
+            }
+            tiles[y * size + x] = match->first;
+        }
+    }
+    return Map(tiles);
+}
+
+Map read_map(const std::string &path, unsigned int size, const std::vector<RoomConfig> &config)
+{
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bmp") == 0)
+    {
+        bitmap_image image(path);
+        if (!image)
+        {
+            throw std::runtime_error("Couldn't read " + path);
+        }
+        auto map = map_from_bitmap(image, config);
+        if (map.size() != size)
+        {
+            throw std::runtime_error(path + " isn't " + std::to_string(size) + "x" +
+                                     std::to_string(size));
+        }
+        return map;
+    }
+    const MappedFile file(path);
+    if (file.size() != std::size_t{size} * size)
+    {
+        throw std::runtime_error(path + " doesn't hold exactly " + std::to_string(size) + "x" +
+                                 std::to_string(size) + " tiles");
+    }
+    check_tiles(file.data(), file.size(), config);
+    // Copied, since a map viewing the file would outlive its mapping
+    return Map(std::vector<unsigned char>(file.data(), file.data() + file.size()));
+}
+
+std::size_t count_mismatches(const Map &a, const Map &b)
+{
+    if (a.size() != b.size())
+    {
+        throw std::invalid_argument("Can't compare maps of different sizes");
+    }
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < a.data().size(); i++)
+    {
+        mismatches += a.data()[i] != b.data()[i];
+    }
+    return mismatches;
+}
+
+std::vector<Room> fit_rooms(const Map &map, const FrozenMask *frozen)
+{
+    std::vector<Room> rooms;
+    for (const auto &component : find_rooms(map, frozen))
+    {
+        Room room{component.type,
+                  component.min_x > 0 ? component.min_x - 1 : 0,
+                  component.min_y > 0 ? component.min_y - 1 : 0,
+                  0,
+                  0,
+                  {false, false, false, false},
+                  {0, 0, 0, 0},
+                  {0, 0, 0, 0},
+                  {}};
+        room.width = component.max_x + 2 - room.x;
+        room.height = component.max_y + 2 - room.y;
+
+        unsigned int doors = 0;
+        for (unsigned int y = room.y; y < room.y + room.height && y < map.size(); y++)
+        {
+            for (unsigned int x = room.x; x < room.x + room.width && x < map.size(); x++)
+            {
+                const bool on_wall = x == room.x || y == room.y ||
+                                     x == room.x + room.width - 1 ||
+                                     y == room.y + room.height - 1;
+                if (doors < 4 && on_wall && map.get(x, y) == door)
+                {
+                    room.doors_active[doors] = true;
+                    room.door_xs[doors] = x - room.x;
+                    room.door_ys[doors] = y - room.y;
+                    doors++;
+                }
+            }
+        }
+        rooms.push_back(room);
+    }
+    return rooms;
+}
+
+std::vector<Node> fit_tree(const Map &map, const std::vector<RoomConfig> &config, Rng &rng,
+                           unsigned int steps, const FrozenMask *frozen)
+{
+    std::vector<Node> nodes;
+    for (const auto &room : find_rooms(map, frozen))
+    {
+        nodes.push_back({room.center_x, room.center_y, room.type, {0, 0, 0, 0}});
+    }
+    // Floor nodes keep the rooms around open areas from spreading into them
+    Bitboard floor_mask(map.size());
+    for (unsigned int y = 0; y < map.size(); y++)
+    {
+        for (unsigned int x = 0; x < map.size(); x++)
+        {
+            if (map.get(x, y) == floor)
+            {
+                floor_mask.set(x, y);
+            }
+        }
+    }
+    for (const auto &area : find_components(floor_mask, floor))
+    {
+        if (area.size >= 9 || nodes.empty())
+        {
+            nodes.push_back({area.center_x, area.center_y, floor, {0, 0, 0, 0}});
+        }
+    }
+    if (nodes.empty())
+    {
+        nodes.push_back({map.size() / 2, map.size() / 2, floor, {0, 0, 0, 0}});
+    }
+
+    auto mismatches = count_mismatches(Map(map.size(), nodes, frozen), map);
+    for (unsigned int step = 0; step < steps && mismatches > 0; step++)
+    {
+        auto candidate = permute(nodes, config, rng, frozen);
+        if (candidate.empty())
+        {
+            continue;
+        }
+        const auto candidate_mismatches =
+            count_mismatches(Map(map.size(), candidate, frozen), map);
+        if (candidate_mismatches <= mismatches)
+        {
+            nodes = std::move(candidate);
+            mismatches = candidate_mismatches;
+        }
+    }
+    return nodes;
+}
+
+TEST_CASE("Importing maps")
+{
+    const auto config = read_config_from_file("config.yml");
+    const Map map(map_size, sample_rooms());
+
+    SUBCASE("Reads back saved images")
+    {
+        const auto imported = map_from_bitmap(map.to_bitmap(config_to_color_map(config)), config);
+
+        CHECK(count_mismatches(imported, map) == 0);
+    }
+
+    SUBCASE("Rejects colours that aren't in the config")
+    {
+        bitmap_image image(2, 2);
+        image.set_all_channels(255, 255, 255);
+        image.set_pixel(1, 1, rgb_t{1, 2, 3});
+
+        CHECK_THROWS(map_from_bitmap(image, config));
+    }
+
+    SUBCASE("Reads raw tiles, rejecting ones that aren't in the config")
+    {
+        const auto path = (std::filesystem::temp_directory_path() / "rlo_import_test.bin").string();
+        std::vector<unsigned char> tiles(map.data().begin(), map.data().end());
+        std::ofstream(path, std::ios::binary)
+            .write(reinterpret_cast<const char *>(tiles.data()),
+                   static_cast<std::streamsize>(tiles.size()));
+        CHECK(count_mismatches(read_map(path, map_size, config), map) == 0);
+
+        tiles[42] = 200;
+        std::ofstream(path, std::ios::binary)
+            .write(reinterpret_cast<const char *>(tiles.data()),
+                   static_cast<std::streamsize>(tiles.size()));
+        CHECK_THROWS(read_map(path, map_size, config));
+        std::filesystem::remove(path);
+    }
+
+    SUBCASE("Fits rooms that rasterize back to the same map")
+    {
+        const auto fitted = fit_rooms(map);
+
+        CHECK(fitted.size() == 3);
+        CHECK(count_mismatches(Map(map_size, fitted), map) == 0);
+    }
+
+    SUBCASE("Fits a tree closer than its starting nodes")
+    {
+        Rng rng(4);
+        const auto unfitted = fit_tree(map, config, rng, 0);
+        const auto fitted = fit_tree(map, config, rng, 2000);
+
+        CHECK(count_mismatches(Map(map_size, fitted), map) <
+              count_mismatches(Map(map_size, unfitted), map));
+    }
+
+    SUBCASE("Leaves rooms under frozen tiles to the mask")
+    {
+        const Map frozen_room(map_size, std::vector<Room>{sample_rooms().front()});
+        const FrozenMask frozen(map_size, frozen_room.data());
+        Rng rng(4);
+
+        CHECK(fit_rooms(map, &frozen).size() == 2);
+        for (const auto &node : fit_tree(map, config, rng, 2000, &frozen))
+        {
+            CHECK_FALSE(frozen.contains(node.x, node.y));
+        }
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "bitmap.hpp"
+#include "config.hpp"
+#include "frozen.hpp"
+#include "map.hpp"
+#include "rng.hpp"
+
+namespace rlo
+{
+// Turns an image saved by the optimizer back into a map by looking each pixel's colour up in
+// config_to_color_map(). Colours the config doesn't use are an error.
+Map map_from_bitmap(const bitmap_image &image, const std::vector<RoomConfig> &config);
+
+// Loads a .bmp with map_from_bitmap(), or any other file as raw size * size tiles
+Map read_map(const std::string &path, unsigned int size, const std::vector<RoomConfig> &config);
+
+// How many tiles differ between two maps of the same size
+std::size_t count_mismatches(const Map &a, const Map &b);
+
+// One rectangle per connected room on the map, covering the room and the walls around it, with
+// up to four of the doors on those walls. Room tiles under `frozen` are left to the mask.
+std::vector<Room> fit_rooms(const Map &map, const FrozenMask *frozen = nullptr);
+
+// A K-D tree whose rasterization comes as close to the map as `steps` rounds of local search
+// manage. It starts from a node at the middle of every room and of every open area of floor,
+// then keeps any permute() that doesn't make more tiles differ. Room tiles under `frozen` are left
+// to the mask, and no node is placed on one of its tiles.
+std::vector<Node> fit_tree(const Map &map, const std::vector<RoomConfig> &config, Rng &rng,
+                           unsigned int steps = 20000, const FrozenMask *frozen = nullptr);
+}
\ No newline at end of file
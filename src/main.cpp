@@ -1,27 +1,326 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
 #include <argh.h>
-#define DOCTEST_CONFIG_IMPLEMENT
-#include <doctest/doctest.h>
 
+#include "batch.hpp"
+#include "benchmark.hpp"
 #include "config.hpp"
+#include "daemon.hpp"
+#include "evaluate.hpp"
+#include "frozen.hpp"
+#include "genetic.hpp"
+#include "import.hpp"
 #include "optimize.hpp"
+#include "profiler.hpp"
+#include "racing.hpp"
+#include "schedule.hpp"
+#include "store.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
+#include "verify.hpp"
 
-int run_tests(int argc, char *argv[])
+namespace
+{
+// Starts every chain from a layout fitted to `initial` when there is one, and saves the result
+// to the store when it beats what's there
+template <class Genome>
+void optimize(const std::vector<rlo::RoomConfig> &config, const rlo::OptimizationOptions &options,
+              const std::optional<rlo::Map> &initial, rlo::ResultStore *store)
 {
-    doctest::Context context;
-    context.applyCommandLine(argc, argv);
-    return context.run();
+    std::vector<Genome> initial_layouts;
+    if (initial)
+    {
+        if constexpr (std::is_same_v<Genome, std::vector<rlo::Room>>)
+        {
+            initial_layouts.push_back(rlo::fit_rooms(*initial, options.frozen.get()));
+        }
+        else
+        {
+            rlo::Rng rng(options.seed == 0 ? rlo::random_seed() : options.seed);
+            initial_layouts.push_back(
+                rlo::fit_tree(*initial, config, rng, 20000, options.frozen.get()));
+        }
+        std::cerr << "Starting from a fitted layout "
+                  << rlo::count_mismatches(
+                         rlo::Map(rlo::map_size, initial_layouts.front(), options.frozen.get()),
+                         *initial)
+                  << " tiles away from the initial one\n";
+    }
+    const auto result = rlo::run_optimization<Genome>(config, options, initial_layouts);
+    if (store &&
+        store->record(config, result.score,
+                      rlo::Map(rlo::map_size, result.best, options.frozen.get())))
+    {
+        std::cerr << "Saved the new best layout to the result store\n";
+    }
 }
 
-int main(int argc, char *argv[])
+int run(int argc, char *argv[])
 {
-    argh::parser args(argv);
-    if (args[{"-t", "--test"}])
+    argh::parser args;
+    args.add_params({"--chains", "--iterations", "--steps", "--evaluation-threads", "--schedule",
+                     "--reheat-after", "--time-budget", "--mode", "--population",
+                     "--generations", "--starts", "--genome", "--samples", "--seed", "--config",
+                     "--manifest", "--batch-output", "--jobs", "--maps", "--frozen",
+                     "--placement", "--mutations", "--tolerance", "--relative-tolerance",
+                     "--initial", "--start-progress", "--store", "--speculation"});
+    args.parse(argc, argv);
+
+    if (args["--profile"])
+    {
+        rlo::set_profiling(true);
+        std::atexit([] { rlo::print_profile(std::cerr); });
+    }
+
+    std::string placement;
+    args("--placement", "none") >> placement;
+    if (placement != "none")
+    {
+        const auto topology = rlo::read_cpu_topology();
+        const auto bound = rlo::ThreadPool::shared().place(
+            topology, rlo::parse_thread_placement(placement));
+        std::cerr << "Bound " << bound << " threads across " << topology.nodes.size()
+                  << " NUMA nodes\n";
+    }
+
+    std::string mode;
+    args("--mode", "threshold") >> mode;
+    const std::vector<std::string> modes{"threshold", "daemon", "score", "benchmark",
+                                         "verify-eval", "genetic", "racing", "batch"};
+    if (std::find(modes.begin(), modes.end(), mode) == modes.end())
+    {
+        throw std::runtime_error("Unknown mode: " + mode);
+    }
+    // Only the plain threshold run starts from a given layout and keeps a result store. Batch
+    // jobs each have their own config, and racing picks its own starting layouts.
+    std::string unused;
+    for (const auto *flag : {"--initial", "--store"})
+    {
+        if (mode != "threshold" && args(flag) >> unused)
+        {
+            throw std::runtime_error(std::string(flag) + " isn't supported in the " + mode +
+                                     " mode");
+        }
+    }
+    if (mode == "daemon")
+    {
+        rlo::run_daemon(std::cin, std::cout);
+        return 0;
+    }
+
+    std::string genome;
+    std::string config_path;
+    args("--genome", "tree") >> genome;
+    args("--config", "config.yml") >> config_path;
+    // Batch jobs read their configs from the manifest instead
+    const auto config = mode == "batch" ? std::vector<rlo::RoomConfig>()
+                                        : rlo::read_config_from_file(config_path);
+    if (genome != "tree" && genome != "rooms")
+    {
+        throw std::runtime_error("Unknown genome: " + genome);
+    }
+    if (mode == "score")
+    {
+        std::string maps;
+        args("--maps", "maps.bin") >> maps;
+        auto &pool = rlo::ThreadPool::shared();
+        const auto start = std::chrono::steady_clock::now();
+        const auto scores = rlo::evaluate_file(maps, rlo::map_size, rlo::EvaluationTables(config),
+                                               {&pool, pool.size() + 1});
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        for (const auto score : scores)
+        {
+            std::cout << std::to_string(score) << "\n";
+        }
+        std::cerr << "Scored " << scores.size() << " maps in " << std::to_string(elapsed.count())
+                  << "s\n";
+        return 0;
+    }
+    if (mode == "benchmark")
+    {
+        unsigned int samples;
+        args("--samples", 200) >> samples;
+        rlo::run_benchmark(config, samples);
+        return 0;
+    }
+    if (mode == "verify-eval")
+    {
+        rlo::VerificationOptions verification;
+        args("--samples", verification.layouts) >> verification.layouts;
+        args("--mutations", verification.mutations) >> verification.mutations;
+        args("--tolerance", verification.tolerance) >> verification.tolerance;
+        args("--relative-tolerance", verification.relative_tolerance) >>
+            verification.relative_tolerance;
+        args("--seed", verification.seed) >> verification.seed;
+        args("--evaluation-threads", verification.evaluation_threads) >>
+            verification.evaluation_threads;
+        const auto result = rlo::verify_evaluation(config, verification);
+        std::cout << "Checked " << result.samples << " layouts, largest difference "
+                  << std::to_string(result.max_difference) << "\n";
+        std::cout << "Fast: " << std::to_string(result.fast_seconds)
+                  << "s, reference: " << std::to_string(result.reference_seconds) << "s\n";
+        if (result.first_divergence)
+        {
+            const auto &divergence = *result.first_divergence;
+            std::cout << "Layout " << divergence.sample << " diverges: fast "
+                      << std::to_string(divergence.fast) << ", reference "
+                      << std::to_string(divergence.reference) << "\n";
+            rlo::Map(rlo::map_size, divergence.layout)
+                .to_bitmap(rlo::config_to_color_map(config))
+                .save_image("divergence.bmp");
+            std::cout << "Saved it to divergence.bmp\n";
+            return 1;
+        }
+        return 0;
+    }
+    // Batch jobs each read the mask against their own config
+    std::string frozen_path;
+    std::shared_ptr<const rlo::FrozenMask> frozen;
+    if (args("--frozen") >> frozen_path && mode != "batch")
+    {
+        frozen = std::make_shared<rlo::FrozenMask>(
+            rlo::read_frozen_mask(frozen_path, rlo::map_size, config));
+    }
+    if (mode == "genetic")
     {
-        return run_tests(argc, argv);
+        // Crossover splices K-D trees, so there is no room list version of this mode
+        if (genome != "tree")
+        {
+            throw std::runtime_error("The genetic mode only supports the tree genome");
+        }
+        rlo::GeneticOptions options;
+        args("--population", options.population) >> options.population;
+        args("--generations", options.generations) >> options.generations;
+        args("--evaluation-threads", options.evaluation_threads) >> options.evaluation_threads;
+        args("--seed", options.seed) >> options.seed;
+        options.frozen = frozen;
+        if (args["--fixed-point"])
+        {
+            options.arithmetic = rlo::ScoreArithmetic::fixed_point;
+        }
+        rlo::run_genetic(config, options);
+        return 0;
     }
 
-    const auto config = rlo::read_config_from_file("config.yml");
-    rlo::run_optimization(config);
+    rlo::OptimizationOptions options;
+    args("--chains", options.chains) >> options.chains;
+    args("--iterations", options.iterations) >> options.iterations;
+    args("--steps", options.steps_per_iteration) >> options.steps_per_iteration;
+    args("--evaluation-threads", options.evaluation_threads) >> options.evaluation_threads;
+    args("--speculation", options.speculation) >> options.speculation;
+    args("--time-budget", options.time_budget) >> options.time_budget;
+    args("--seed", options.seed) >> options.seed;
+    options.adaptive_operators = args["--adaptive-operators"];
+    options.surrogate = args["--surrogate"];
+    options.incremental_distances = args["--incremental-distances"];
+    if (args["--fixed-point"])
+    {
+        options.arithmetic = rlo::ScoreArithmetic::fixed_point;
+    }
+    std::string schedule;
+    unsigned int reheat_after;
+    args("--schedule", "phased") >> schedule;
+    args("--reheat-after", 0) >> reheat_after;
+    options.schedule = rlo::make_schedule(schedule, options.iterations, reheat_after);
+    options.frozen = frozen;
+    if (mode == "batch")
+    {
+        std::string manifest;
+        rlo::BatchOptions batch;
+        args("--manifest", "manifest.txt") >> manifest;
+        args("--batch-output", batch.output_directory) >> batch.output_directory;
+        args("--jobs", batch.parallel_jobs) >> batch.parallel_jobs;
+        batch.frozen_path = frozen_path;
+        if (genome == "rooms")
+        {
+            rlo::run_batch<std::vector<rlo::Room>>(manifest, options, batch);
+        }
+        else
+        {
+            rlo::run_batch<std::vector<rlo::Node>>(manifest, options, batch);
+        }
+        return 0;
+    }
+    if (mode == "racing")
+    {
+        rlo::RacingOptions racing;
+        args("--starts", racing.starts) >> racing.starts;
+        if (genome == "rooms")
+        {
+            rlo::run_racing<std::vector<rlo::Room>>(config, options, racing);
+        }
+        else
+        {
+            rlo::run_racing<std::vector<rlo::Node>>(config, options, racing);
+        }
+        return 0;
+    }
+    std::optional<rlo::Map> initial;
+    std::string initial_path;
+    if (args("--initial") >> initial_path)
+    {
+        initial = rlo::read_map(initial_path, rlo::map_size, config);
+    }
+    std::unique_ptr<rlo::ResultStore> store;
+    std::string store_path;
+    if (args("--store") >> store_path)
+    {
+        store = std::make_unique<rlo::ResultStore>(store_path);
+        const auto stored = store->nearest(config, rlo::map_size);
+        if (!initial && stored)
+        {
+            std::cerr << "Seeding from the stored layout for "
+                      << (stored->exact ? "this config" : "the nearest config") << ", scoring "
+                      << stored->score << "\n";
+            rlo::check_tiles(stored->tiles.data(), stored->tiles.size(), config);
+            initial.emplace(stored->tiles);
+        }
+    }
+    // A layout carried over is already past the exploratory start of the schedule, and starting
+    // from the top would mostly scramble it again
+    args("--start-progress", initial ? 0.5 : 0.) >> options.start_progress;
+    // The part of the schedule skipped counts as budget already spent. The schedule itself stays
+    // laid out over the full budget, so the run picks it up where a fresh one would be.
+    if (options.start_progress > 0)
+    {
+        const auto remaining = std::max(1. - options.start_progress, 0.);
+        options.iterations = std::max(
+            1u, static_cast<unsigned int>(std::lround(options.iterations * remaining)));
+        options.time_budget *= remaining;
+    }
+    if (genome == "rooms")
+    {
+        optimize<std::vector<rlo::Room>>(config, options, initial, store.get());
+    }
+    else
+    {
+        optimize<std::vector<rlo::Node>>(config, options, initial, store.get());
+    }
 
     return 0;
 }
+}
+
+int main(int argc, char *argv[])
+{
+    // Bad arguments and unreadable inputs surface as exceptions
+    try
+    {
+        return run(argc, argv);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+}
@@ -5,15 +5,19 @@
 
 #include "bitmap.hpp"
 #include "config.hpp"
+#include "frozen.hpp"
 #include "map.hpp"
+#include "profiler.hpp"
 #include "utils.hpp"
 
 namespace rlo
 {
-Map::Map(unsigned int size, const std::vector<Room> &rooms)
+Map::Map(unsigned int size, const std::vector<Room> &rooms, const FrozenMask *frozen)
 {
+    ProfileScope profile(ProfileStage::rasterize);
     m_size = size;
-    m_data = std::vector<unsigned char>(m_size * m_size, floor);
+    m_storage = std::vector<unsigned char>(m_size * m_size, floor);
+    m_tiles = m_storage.data();
 
     for (const auto &room : rooms)
     {
@@ -42,22 +46,99 @@ Map::Map(unsigned int size, const std::vector<Room> &rooms)
             }
         }
     }
+
+    if (frozen != nullptr)
+    {
+        frozen->apply(m_storage);
+    }
+    build_bitboards();
 }
 
 Map::Map(const std::vector<unsigned char> &data)
 {
     m_size = static_cast<unsigned int>(std::sqrt(data.size()));
-    m_data = data;
+    m_storage = data;
+    m_tiles = m_storage.data();
+    build_bitboards();
 }
 
-Map::Map(unsigned int size, const std::vector<Node> &nodes)
+Map::Map(unsigned int size, const std::vector<Node> &nodes, const FrozenMask *frozen)
 {
+    ProfileScope profile(ProfileStage::rasterize);
     // K-D tree map construction
     m_size = size;
-    m_data = std::vector<unsigned char>(m_size * m_size, floor);
+    m_storage = std::vector<unsigned char>(m_size * m_size, floor);
+    m_tiles = m_storage.data();
 
     auto nodes_copy = nodes;
     make_tree({0, 0}, {size - 1, size - 1}, nodes_copy, 0, nodes.size());
+    if (frozen != nullptr)
+    {
+        frozen->apply(m_storage);
+    }
+    build_bitboards();
+}
+
+Map::Map(unsigned int size, TileSpan tiles) : m_size(size), m_tiles(tiles.tiles)
+{
+    if (tiles.size() < std::size_t{size} * size)
+    {
+        throw std::invalid_argument("Tile buffer is smaller than the map");
+    }
+    build_bitboards();
+}
+
+Map::Map(const Map &other)
+    : m_size(other.m_size),
+      m_tiles(other.m_tiles),
+      m_storage(other.m_storage),
+      m_walls(other.m_walls),
+      m_doors(other.m_doors),
+      m_room_masks(other.m_room_masks),
+      m_empty(other.m_empty)
+{
+    // A copy of an owning map owns its own copy of the tiles; a copy of a view shares the buffer
+    if (!m_storage.empty())
+    {
+        m_tiles = m_storage.data();
+    }
+}
+
+Map &Map::operator=(const Map &other)
+{
+    return *this = Map(other);
+}
+
+void Map::build_bitboards()
+{
+    m_walls = Bitboard(m_size);
+    m_doors = Bitboard(m_size);
+    m_empty = Bitboard(m_size);
+    m_room_masks.clear();
+
+    for (unsigned int y = 0; y < m_size; y++)
+    {
+        for (unsigned int x = 0; x < m_size; x++)
+        {
+            const auto tile = m_tiles[y * m_size + x];
+            if (tile == wall)
+            {
+                m_walls.set(x, y);
+            }
+            else if (tile == door)
+            {
+                m_doors.set(x, y);
+            }
+            else if (tile != floor)
+            {
+                if (tile >= m_room_masks.size())
+                {
+                    m_room_masks.resize(tile + 1u, m_empty);
+                }
+                m_room_masks[tile].set(x, y);
+            }
+        }
+    }
 }
 
 void Map::make_tree(std::pair<unsigned int, unsigned int> boundary_tl,
@@ -197,7 +278,7 @@ bitmap_image Map::to_bitmap(const std::unordered_map<unsigned char, rgb_t> &colo
     {
         for (unsigned int y = 0; y < m_size; y++)
         {
-            image.set_pixel(x, y, color_map.at(m_data[y * m_size + x]));
+            image.set_pixel(x, y, color_map.at(m_tiles[y * m_size + x]));
         }
     }
 
@@ -308,6 +389,111 @@ TEST_CASE("Map")
         Map map(100, nodes);
     }
 
+    SUBCASE("Bitboards")
+    {
+        const auto map = Map(
+            10,
+            {Room{25, 1, 2, 3, 4, {true, false, true, false}, {0, 0, 2, 0}, {0, 0, 1, 0}, {}}});
+
+        SUBCASE("Mirror the tile data")
+        {
+            for (unsigned int x = 0; x < 10; x++)
+            {
+                for (unsigned int y = 0; y < 10; y++)
+                {
+                    CHECK(map.walls().get(x, y) == (map.get(x, y) == wall));
+                    CHECK(map.doors().get(x, y) == (map.get(x, y) == door));
+                    CHECK(map.room_mask(25).get(x, y) == (map.get(x, y) == 25));
+                }
+            }
+        }
+
+        SUBCASE("Return an empty mask for room types that aren't on the map")
+        {
+            CHECK(!map.room_mask(3).any());
+            CHECK(!map.room_mask(26).any());
+        }
+    }
+
+    SUBCASE("Tile views")
+    {
+        const auto owned = Map(
+            10,
+            {Room{25, 1, 2, 3, 4, {true, false, true, false}, {0, 0, 2, 0}, {0, 0, 1, 0}, {}}});
+        const std::vector<unsigned char> buffer(owned.data().begin(), owned.data().end());
+        const Map view(10, TileSpan{buffer.data(), buffer.size()});
+
+        SUBCASE("Read the caller's buffer in place")
+        {
+            CHECK(view.data().begin() == buffer.data());
+            for (unsigned int x = 0; x < 10; x++)
+            {
+                for (unsigned int y = 0; y < 10; y++)
+                {
+                    CHECK(view.get(x, y) == owned.get(x, y));
+                }
+            }
+            CHECK(view.walls() == owned.walls());
+        }
+
+        SUBCASE("Copies of owning maps get their own tiles")
+        {
+            const auto copy = owned;
+
+            CHECK(copy.data().begin() != owned.data().begin());
+            CHECK(copy.get(1, 2) == owned.get(1, 2));
+        }
+
+        SUBCASE("Reject buffers that are too small")
+        {
+            CHECK_THROWS(Map(10, TileSpan{buffer.data(), 99}));
+        }
+    }
+
+    SUBCASE("Frozen tiles")
+    {
+        std::vector<unsigned char> frozen_tiles(100, floor);
+        frozen_tiles[3 * 10 + 2] = 7;
+        frozen_tiles[9 * 10 + 9] = door;
+        const FrozenMask frozen(10, {frozen_tiles.data(), frozen_tiles.size()});
+
+        SUBCASE("Survive rooms drawn over them")
+        {
+            const auto map = Map(10,
+                                 {Room{25,
+                                       1,
+                                       2,
+                                       3,
+                                       4,
+                                       {false, false, false, false},
+                                       {0, 0, 0, 0},
+                                       {0, 0, 0, 0},
+                                       {}}},
+                                 &frozen);
+
+            CHECK(map.get(2, 3) == 7);
+            CHECK(map.get(2, 4) == 25);
+            CHECK(map.get(9, 9) == door);
+            CHECK(map.room_mask(7).get(2, 3));
+            CHECK(!map.room_mask(25).get(2, 3));
+        }
+
+        SUBCASE("Survive the K-D tree's walls")
+        {
+            const auto map = Map(10, std::vector<Node>{Node{5, 5, 25, {0, 0, 0, 0}}}, &frozen);
+
+            CHECK(map.get(2, 3) == 7);
+            CHECK(map.get(9, 9) == door);
+            CHECK(map.doors().get(9, 9));
+            CHECK(map.get(5, 0) == wall);
+        }
+
+        SUBCASE("Must match the map's size")
+        {
+            CHECK_THROWS(Map(5, std::vector<Room>{}, &frozen));
+        }
+    }
+
     SUBCASE("to_bitmap()")
     {
         SUBCASE("When called on a blank map, should produce a white image")
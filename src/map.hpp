@@ -2,14 +2,19 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
+#include "bitboard.hpp"
 #include "bitmap.hpp"
 
 namespace rlo
 {
+class FrozenMask;
+
 struct Room
 {
     unsigned char type;
@@ -31,33 +36,73 @@ struct Node
     std::array<unsigned int, 4> door_positions;
 };
 
+// A read-only view of a row-major buffer of tiles owned by someone else
+struct TileSpan
+{
+    const unsigned char *tiles;
+    std::size_t length;
+
+    inline const unsigned char *begin() const { return tiles; }
+    inline const unsigned char *end() const { return tiles + length; }
+    inline std::size_t size() const { return length; }
+    inline unsigned char operator[](std::size_t i) const { return tiles[i]; }
+};
+
 class Map
 {
   private:
     unsigned int m_size;
-    std::vector<unsigned char> m_data;
+    // Points into m_storage, or into the caller's buffer for maps that view one
+    const unsigned char *m_tiles;
+    std::vector<unsigned char> m_storage;
+    Bitboard m_walls;
+    Bitboard m_doors;
+    // Indexed by room type, only as long as the highest room type present on the map
+    std::vector<Bitboard> m_room_masks;
+    Bitboard m_empty;
 
+    void build_bitboards();
     void make_tree(std::pair<unsigned int, unsigned int> boundary_tl,
                    std::pair<unsigned int, unsigned int> boundary_br, std::vector<Node> &nodes,
                    std::size_t begin, std::size_t end);
 
     inline void set(unsigned int x, unsigned int y, unsigned char value)
     {
-        m_data.at(y * m_size + x) = value;
+        m_storage.at(y * m_size + x) = value;
     }
 
   public:
-    Map(unsigned int size, const std::vector<Room> &rooms);
+    // The rasterizing constructors leave every tile of `frozen` as it is in the mask
+    Map(unsigned int size, const std::vector<Room> &rooms, const FrozenMask *frozen = nullptr);
     Map(const std::vector<unsigned char> &data);
-    Map(unsigned int size, const std::vector<Node> &nodes);
+    Map(unsigned int size, const std::vector<Node> &nodes, const FrozenMask *frozen = nullptr);
+    // Views size * size tiles in place without copying them. The buffer must outlive the map
+    // and any copies of it.
+    Map(unsigned int size, TileSpan tiles);
+
+    Map(const Map &other);
+    Map(Map &&other) noexcept = default;
+    Map &operator=(const Map &other);
+    Map &operator=(Map &&other) noexcept = default;
 
     bitmap_image to_bitmap(const std::unordered_map<unsigned char, rgb_t> &color_map) const;
 
-    inline const std::vector<unsigned char> &data() const { return m_data; }
+    inline TileSpan data() const { return {m_tiles, std::size_t{m_size} * m_size}; }
     inline unsigned int size() const { return m_size; }
+    inline const Bitboard &walls() const { return m_walls; }
+    inline const Bitboard &doors() const { return m_doors; }
+    inline const Bitboard &room_mask(unsigned char type) const
+    {
+        return type < m_room_masks.size() ? m_room_masks[type] : m_empty;
+    }
+    inline Bitboard passable() const { return ~m_walls; }
     inline unsigned char get(unsigned int x, unsigned int y) const
     {
-        return m_data.at(y * m_size + x);
+        if (x >= m_size || y >= m_size)
+        {
+            throw std::out_of_range("Map::get");
+        }
+        return m_tiles[y * m_size + x];
     }
 };
 }
\ No newline at end of file
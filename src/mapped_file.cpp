@@ -0,0 +1,55 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+namespace rlo
+{
+MappedFile::MappedFile(const std::string &path) : m_data(nullptr), m_size(0)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("Couldn't open " + path + ": " + std::strerror(errno));
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        const auto error = errno;
+        close(file);
+        throw std::runtime_error("Couldn't stat " + path + ": " + std::strerror(error));
+    }
+    m_size = static_cast<std::size_t>(status.st_size);
+
+    // mmap() refuses empty mappings, and an empty file has nothing to read anyway
+    if (m_size > 0)
+    {
+        void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping == MAP_FAILED)
+        {
+            const auto error = errno;
+            close(file);
+            throw std::runtime_error("Couldn't map " + path + ": " + std::strerror(error));
+        }
+        // The pages are read front to back
+        madvise(mapping, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const unsigned char *>(mapping);
+    }
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<unsigned char *>(m_data), m_size);
+    }
+}
+}
\ No newline at end of file
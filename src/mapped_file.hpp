@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace rlo
+{
+// A whole file mapped read-only into memory for as long as this lives
+class MappedFile
+{
+  private:
+    const unsigned char *m_data;
+    std::size_t m_size;
+
+  public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    inline const unsigned char *data() const { return m_data; }
+    inline std::size_t size() const { return m_size; }
+};
+}
\ No newline at end of file
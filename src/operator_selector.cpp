@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "operator_selector.hpp"
+
+namespace rlo
+{
+OperatorSelector::OperatorSelector(std::vector<std::string> names,
+                                   std::vector<double> base_probabilities, bool adaptive,
+                                   double min_probability, double smoothing)
+    : m_base_probabilities(base_probabilities),
+      m_probabilities(base_probabilities),
+      m_average_improvement(base_probabilities.size(), 0),
+      m_average_seconds(base_probabilities.size(), 0),
+      m_adaptive(adaptive),
+      m_min_probability(min_probability),
+      m_smoothing(smoothing)
+{
+    for (auto &name : names)
+    {
+        OperatorStatistics statistics;
+        statistics.name = std::move(name);
+        m_statistics.push_back(statistics);
+    }
+}
+
+void OperatorSelector::record(std::size_t chosen, float improvement, double seconds)
+{
+    const double gain = std::max(static_cast<double>(improvement), 0.);
+    auto &statistics = m_statistics[chosen];
+    statistics.uses++;
+    statistics.total_seconds += seconds;
+    if (gain > 0)
+    {
+        statistics.improvements++;
+        statistics.total_improvement += gain;
+    }
+
+    if (!m_adaptive)
+    {
+        return;
+    }
+    // The first use seeds the averages so one early sample isn't diluted towards zero
+    if (statistics.uses == 1)
+    {
+        m_average_improvement[chosen] = gain;
+        m_average_seconds[chosen] = seconds;
+    }
+    else
+    {
+        m_average_improvement[chosen] += m_smoothing * (gain - m_average_improvement[chosen]);
+        m_average_seconds[chosen] += m_smoothing * (seconds - m_average_seconds[chosen]);
+    }
+    update_probabilities();
+}
+
+void OperatorSelector::update_probabilities()
+{
+    std::vector<double> rates(m_probabilities.size(), 0);
+    for (std::size_t i = 0; i < rates.size(); i++)
+    {
+        // Operators that haven't been tried yet keep their base share until they have been
+        if (m_statistics[i].uses == 0)
+        {
+            rates[i] = -1;
+        }
+        else if (m_average_seconds[i] > 0)
+        {
+            rates[i] = m_average_improvement[i] / m_average_seconds[i];
+        }
+    }
+    const double total_rate = std::accumulate(
+        rates.begin(), rates.end(), 0., [](double a, double b) { return a + std::max(b, 0.); });
+    if (total_rate <= 0 || std::any_of(rates.begin(), rates.end(), [](double r) { return r < 0; }))
+    {
+        m_probabilities = m_base_probabilities;
+        return;
+    }
+
+    const double shared = 1. - m_min_probability * static_cast<double>(rates.size());
+    for (std::size_t i = 0; i < rates.size(); i++)
+    {
+        m_probabilities[i] = m_min_probability + shared * rates[i] / total_rate;
+    }
+}
+
+void OperatorSelector::merge_statistics(const OperatorSelector &other)
+{
+    for (std::size_t i = 0; i < m_statistics.size(); i++)
+    {
+        m_statistics[i].uses += other.m_statistics[i].uses;
+        m_statistics[i].improvements += other.m_statistics[i].improvements;
+        m_statistics[i].total_improvement += other.m_statistics[i].total_improvement;
+        m_statistics[i].total_seconds += other.m_statistics[i].total_seconds;
+    }
+}
+
+void print_operator_statistics(const std::vector<OperatorSelector> &selectors)
+{
+    if (selectors.empty())
+    {
+        return;
+    }
+    auto totals = selectors.front();
+    std::vector<double> mean_probabilities(totals.probabilities().size(), 0);
+    for (std::size_t i = 0; i < selectors.size(); i++)
+    {
+        if (i > 0)
+        {
+            totals.merge_statistics(selectors[i]);
+        }
+        for (std::size_t j = 0; j < mean_probabilities.size(); j++)
+        {
+            mean_probabilities[j] +=
+                selectors[i].probabilities()[j] / static_cast<double>(selectors.size());
+        }
+    }
+
+    std::cout << "Operator statistics:\n";
+    for (std::size_t i = 0; i < totals.statistics().size(); i++)
+    {
+        const auto &statistics = totals.statistics()[i];
+        const auto uses = static_cast<double>(std::max(statistics.uses, 1ul));
+        std::cout << "  " << statistics.name << ": " << statistics.uses << " uses, "
+                  << statistics.improvements << " improvements, "
+                  << std::to_string(statistics.total_improvement / uses) << " mean improvement, "
+                  << std::to_string(statistics.total_seconds / uses * 1000.) << "ms mean eval, "
+                  << std::to_string(mean_probabilities[i]) << " mean final probability\n";
+    }
+}
+
+TEST_CASE("OperatorSelector")
+{
+    Rng rng(0);
+
+    SUBCASE("Draws from the base probabilities when not adapting")
+    {
+        OperatorSelector selector({"a", "b"}, {0.25, 0.75}, false);
+        selector.record(0, 100.f, 0.001);
+        std::vector<int> counts(2, 0);
+        for (int i = 0; i < 10000; i++)
+        {
+            counts[selector.select(rng)]++;
+        }
+
+        CHECK(selector.probabilities() == std::vector<double>{0.25, 0.75});
+        CHECK(counts[0] > 2000);
+        CHECK(counts[0] < 3000);
+    }
+
+    SUBCASE("Shifts probability towards the operator that pays off")
+    {
+        OperatorSelector selector({"a", "b"}, {0.5, 0.5}, true, 0.05);
+        for (int i = 0; i < 100; i++)
+        {
+            selector.record(0, 10.f, 0.001);
+            selector.record(1, -10.f, 0.001);
+        }
+
+        CHECK(selector.probabilities()[0] == doctest::Approx(0.95));
+        CHECK(selector.probabilities()[1] == doctest::Approx(0.05));
+    }
+
+    SUBCASE("Prefers the cheaper of two operators with equal gains")
+    {
+        OperatorSelector selector({"a", "b"}, {0.5, 0.5}, true);
+        selector.record(0, 10.f, 0.001);
+        selector.record(1, 10.f, 0.004);
+
+        CHECK(selector.probabilities()[0] > selector.probabilities()[1]);
+    }
+
+    SUBCASE("Sums statistics across selectors")
+    {
+        OperatorSelector total({"a"}, {1.}, false);
+        OperatorSelector other({"a"}, {1.}, false);
+        other.record(0, 5.f, 1.);
+        other.record(0, 0.f, 1.);
+        total.merge_statistics(other);
+
+        CHECK(total.statistics()[0].uses == 2);
+        CHECK(total.statistics()[0].improvements == 1);
+        CHECK(total.statistics()[0].total_improvement == 5.);
+    }
+}
+}
\ No newline at end of file
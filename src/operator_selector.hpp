@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "rng.hpp"
+
+namespace rlo
+{
+struct OperatorStatistics
+{
+    std::string name;
+    unsigned long uses = 0;
+    unsigned long improvements = 0;
+    double total_improvement = 0;
+    double total_seconds = 0;
+};
+
+// Picks mutation operators for one chain. With adaptation off it always draws from the base
+// probabilities. With adaptation on it tracks a moving average of score improvement per second of
+// evaluation for each operator (a multi-armed bandit over improvement rate) and shifts probability
+// towards the operators currently paying off, never letting any drop below min_probability.
+class OperatorSelector
+{
+  private:
+    std::vector<double> m_base_probabilities;
+    std::vector<double> m_probabilities;
+    std::vector<double> m_average_improvement;
+    std::vector<double> m_average_seconds;
+    std::vector<OperatorStatistics> m_statistics;
+    bool m_adaptive;
+    double m_min_probability;
+    double m_smoothing;
+
+    void update_probabilities();
+
+  public:
+    OperatorSelector(std::vector<std::string> names, std::vector<double> base_probabilities,
+                     bool adaptive, double min_probability = 0.02, double smoothing = 0.02);
+
+    inline std::size_t select(Rng &rng) const
+    {
+        const auto choice = rng.uniform();
+        double cumulative = 0;
+        for (std::size_t i = 0; i + 1 < m_probabilities.size(); i++)
+        {
+            cumulative += m_probabilities[i];
+            if (choice < cumulative)
+            {
+                return i;
+            }
+        }
+        return m_probabilities.size() - 1;
+    }
+
+    // improvement is how much the proposal beat the state it was made from (negative values are
+    // treated as no improvement), seconds is how long it took to evaluate
+    void record(std::size_t chosen, float improvement, double seconds);
+
+    // Adds another selector's usage counts to this one's, for reporting totals across chains
+    void merge_statistics(const OperatorSelector &other);
+
+    inline bool adaptive() const { return m_adaptive; }
+    inline const std::vector<double> &probabilities() const { return m_probabilities; }
+    inline const std::vector<OperatorStatistics> &statistics() const { return m_statistics; }
+};
+
+// Prints usage totals across all the selectors, along with their average final probabilities
+void print_operator_statistics(const std::vector<OperatorSelector> &selectors);
+}
\ No newline at end of file
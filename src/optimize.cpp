@@ -1,186 +1,265 @@
 #include <algorithm>
-#include <future>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
-#include <random>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <doctest/doctest.h>
 
 #include "optimize.hpp"
+#include "best_board.hpp"
 #include "config.hpp"
 #include "evaluate.hpp"
+#include "frozen.hpp"
 #include "map.hpp"
+#include "operator_selector.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+#include "surrogate.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 namespace rlo
 {
-constexpr unsigned int map_size = 100;
 constexpr unsigned int minimum_room_size = 4;
 constexpr unsigned int maximum_room_size = 20;
+// Redraws allowed for a position that lands on a frozen tile, so a mask that leaves almost
+// nothing free can't stall generation
+constexpr unsigned int placement_attempts = 100;
+
+// Carries a coordinate that a nudge left on a frozen tile on in the same direction to the first
+// free tile, or back to where it started if the map ends first
+unsigned int skip_frozen(const FrozenMask *frozen, unsigned int from, unsigned int to,
+                         unsigned int other, bool horizontal)
+{
+    const auto frozen_at = [&](int coordinate) {
+        const auto c = static_cast<unsigned int>(coordinate);
+        return horizontal ? frozen->contains(c, other) : frozen->contains(other, c);
+    };
+    if (frozen == nullptr || to == from || !frozen_at(static_cast<int>(to)))
+    {
+        return to;
+    }
+    const int direction = to > from ? 1 : -1;
+    for (auto c = static_cast<int>(to); c >= 0 && c < static_cast<int>(frozen->size());
+         c += direction)
+    {
+        if (!frozen_at(c))
+        {
+            return static_cast<unsigned int>(c);
+        }
+    }
+    return from;
+}
 
-std::vector<Room> generate_random_rooms(const std::vector<RoomConfig> &config)
+std::vector<Room> generate_random_rooms(const std::vector<RoomConfig> &config, Rng &rng,
+                                        const FrozenMask *frozen)
 {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_int_distribution<unsigned int> position_dist(0, map_size);
-    std::uniform_int_distribution<unsigned int> size_dist(minimum_room_size, maximum_room_size);
+    const auto position = [&] { return rng.below(map_size + 1); };
+    const auto size = [&] {
+        return minimum_room_size + rng.below(maximum_room_size - minimum_room_size + 1);
+    };
 
     std::vector<Room> nodes;
     for (const auto &room_config : config)
     {
         for (unsigned int i = 0; i < room_config.count; i++)
         {
-            const unsigned int width = size_dist(rng);
-            const unsigned int height = size_dist(rng);
-            std::uniform_int_distribution<unsigned int> door_x_dist(0, width);
-            std::uniform_int_distribution<unsigned int> door_y_dist(0, height);
-
-            nodes.emplace_back(
-                Room{room_config.type,
-                     position_dist(rng),
-                     position_dist(rng),
-                     width,
-                     height,
-                     {true, true, true, true},
-                     {door_x_dist(rng), door_x_dist(rng), door_x_dist(rng), door_x_dist(rng)},
-                     {door_y_dist(rng), door_y_dist(rng), door_y_dist(rng), door_y_dist(rng)},
-                     room_config.attributes});
+            const unsigned int width = size();
+            const unsigned int height = size();
+            const auto door_x = [&] { return rng.below(width + 1); };
+            const auto door_y = [&] { return rng.below(height + 1); };
+
+            nodes.emplace_back(Room{room_config.type,
+                                    position(),
+                                    position(),
+                                    width,
+                                    height,
+                                    {true, true, true, true},
+                                    {door_x(), door_x(), door_x(), door_x()},
+                                    {door_y(), door_y(), door_y(), door_y()},
+                                    room_config.attributes});
+            auto &room = nodes.back();
+            for (unsigned int attempt = 0; frozen != nullptr && attempt < placement_attempts &&
+                                           frozen->contains(room.x, room.y);
+                 attempt++)
+            {
+                room.x = position();
+                room.y = position();
+            }
         }
     }
 
     return nodes;
 }
 
-template <class Generator>
-Node generate_random_node(const std::vector<RoomConfig> &config, Generator &rng)
+Node generate_random_node(const std::vector<RoomConfig> &config, Rng &rng,
+                          const FrozenMask *frozen)
 {
-    if (std::uniform_int_distribution<int>(0, 1)(rng))
-    {
-        return {std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                std::uniform_int_distribution<unsigned char>(
-                    0, static_cast<unsigned char>(config.size() - 1))(rng),
-                {std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng)}};
+    Node node;
+    if (rng.below(2))
+    {
+        node = {rng.below(100),
+                rng.below(100),
+                static_cast<unsigned char>(rng.index(config.size())),
+                {rng.below(100), rng.below(100), rng.below(100), rng.below(100)}};
     }
     else
     {
-        return {std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                std::uniform_int_distribution<unsigned int>(0, 99)(rng),
+        node = {rng.below(100),
+                rng.below(100),
                 floor,
-                {std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng),
-                 std::uniform_int_distribution<unsigned int>(0, 99)(rng)}};
+                {rng.below(100), rng.below(100), rng.below(100), rng.below(100)}};
+    }
+    for (unsigned int attempt = 0;
+         frozen != nullptr && attempt < placement_attempts && frozen->contains(node.x, node.y);
+         attempt++)
+    {
+        node.x = rng.below(100);
+        node.y = rng.below(100);
     }
+    return node;
 }
 
-std::vector<Node> generate_random_tree(const std::vector<RoomConfig> &config)
+std::vector<Node> generate_random_tree(const std::vector<RoomConfig> &config, Rng &rng,
+                                       const FrozenMask *frozen)
 {
-    std::random_device dev;
-    std::mt19937 rng(dev());
     std::vector<Node> nodes;
     for (int i = 0; i < 100; i++)
     {
-        nodes.push_back(generate_random_node(config, rng));
+        nodes.push_back(generate_random_node(config, rng, frozen));
     }
 
     return nodes;
 }
 
-template <class Generator>
+enum NodeOperator : std::size_t
+{
+    add_node,
+    remove_node,
+    swap_types,
+    move_door,
+    nudge_x,
+    nudge_y
+};
+
+const std::vector<std::string> node_operator_names{"add node",  "remove node", "swap types",
+                                                   "move door", "nudge x",     "nudge y"};
+const std::vector<double> node_operator_probabilities{0.05, 0.05, 0.15, 0.15, 0.3, 0.3};
+
 std::vector<Node> permute(const std::vector<Node> &input, const std::vector<RoomConfig> &config,
-                          Generator &rng)
+                          Rng &rng, std::size_t mutation, const FrozenMask *frozen)
 {
     std::vector<Node> output(input);
 
-    const auto choice = std::uniform_real_distribution<double>()(rng);
     // Add node
-    if (choice < 0.05)
+    if (mutation == add_node)
     {
-        output.push_back(generate_random_node(config, rng));
+        output.push_back(generate_random_node(config, rng, frozen));
     }
     // Remove node
-    else if (choice < 0.1)
+    else if (mutation == remove_node)
     {
-        output.erase(output.begin() +
-                     std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng));
+        output.erase(output.begin() + rng.index(output.size()));
     }
     // Swap two node's types
-    else if (choice < 0.25)
+    else if (mutation == swap_types)
     {
-        const auto node_1 = std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng);
-        const auto node_2 = std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng);
+        const auto node_1 = rng.index(output.size());
+        const auto node_2 = rng.index(output.size());
         const auto temp = output[node_1].type;
         output[node_1].type = output[node_2].type;
         output[node_2].type = temp;
     }
     // Move a door
-    else if (choice < 0.4)
+    else if (mutation == move_door)
     {
-        const auto node = std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng);
-        const auto door = std::uniform_int_distribution<std::size_t>(0, 3)(rng);
-        const auto adjustment =
-            static_cast<int>(std::round(std::normal_distribution<float>(0, 5)(rng)));
+        const auto node = rng.index(output.size());
+        const auto door = rng.below(4);
+        const auto adjustment = static_cast<int>(std::round(rng.normal(0, 5)));
         output[node].door_positions[door] =
             std::clamp(static_cast<int>(output[node].door_positions[door]) + adjustment, 0, 100);
     }
     // Nudge a node's x coordinate
-    else if (choice < 0.7)
+    else if (mutation == nudge_x)
     {
-        const auto node = std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng);
-        const auto adjustment =
-            static_cast<int>(std::round(std::normal_distribution<float>(0, 5)(rng)));
-        output[node].x = std::clamp(static_cast<int>(output[node].x) + adjustment, 0,
-                                    static_cast<int>(map_size) - 1);
+        const auto node = rng.index(output.size());
+        const auto adjustment = static_cast<int>(std::round(rng.normal(0, 5)));
+        const auto x = std::clamp(static_cast<int>(output[node].x) + adjustment, 0,
+                                  static_cast<int>(map_size) - 1);
+        output[node].x = skip_frozen(frozen, output[node].x, static_cast<unsigned int>(x),
+                                     output[node].y, true);
     }
     // Nudge a node's y coordinate
     else
     {
-        const auto node = std::uniform_int_distribution<std::size_t>(0, output.size() - 1)(rng);
-        const auto adjustment =
-            static_cast<int>(std::round(std::normal_distribution<float>(0, 5)(rng)));
-        output[node].y = std::clamp(static_cast<int>(output[node].y) + adjustment, 0,
-                                    static_cast<int>(map_size) - 1);
+        const auto node = rng.index(output.size());
+        const auto adjustment = static_cast<int>(std::round(rng.normal(0, 5)));
+        const auto y = std::clamp(static_cast<int>(output[node].y) + adjustment, 0,
+                                  static_cast<int>(map_size) - 1);
+        output[node].y = skip_frozen(frozen, output[node].y, static_cast<unsigned int>(y),
+                                     output[node].x, false);
     }
 
     return output;
 }
 
-template <class Generator>
-std::vector<Room> permute(const std::vector<Room> &input, Generator &rng)
+std::vector<Node> permute(const std::vector<Node> &input, const std::vector<RoomConfig> &config,
+                          Rng &rng, const FrozenMask *frozen)
+{
+    static const OperatorSelector selector(node_operator_names, node_operator_probabilities, false);
+    return permute(input, config, rng, selector.select(rng), frozen);
+}
+
+enum RoomOperator : std::size_t
+{
+    adjust_room,
+    swap_rooms
+};
+
+const std::vector<std::string> room_operator_names{"adjust room", "swap rooms"};
+const std::vector<double> room_operator_probabilities{0.05, 0.95};
+
+std::vector<Room> permute(const std::vector<Room> &input, Rng &rng, std::size_t mutation,
+                          const FrozenMask *frozen)
 {
     std::vector<Room> output(input);
 
-    const auto choice = std::uniform_real_distribution<double>()(rng);
     // Apply a random adjustment to a single room
-    if (choice < 0.05)
+    if (mutation == adjust_room)
     {
-        const unsigned int room_index = std::uniform_int_distribution<unsigned int>(
-            0, static_cast<unsigned int>(output.size()) - 1)(rng);
-        auto &room = output[room_index];
+        auto &room = output[rng.index(output.size())];
 
-        const auto move_type = std::uniform_int_distribution<unsigned int>(0, 5)(rng);
+        const auto move_type = rng.below(6);
         int move_amount;
         unsigned int door_choice;
         switch (move_type)
         {
         case 0: // X
-            move_amount =
-                static_cast<int>(std::round(std::normal_distribution<double>(0, 3)(rng)));
-            room.x = std::clamp(static_cast<int>(room.x) + move_amount, 0,
-                                static_cast<int>(map_size) - 1);
+            move_amount = static_cast<int>(std::round(rng.normal(0, 3)));
+            room.x = skip_frozen(frozen, room.x,
+                                 static_cast<unsigned int>(
+                                     std::clamp(static_cast<int>(room.x) + move_amount, 0,
+                                                static_cast<int>(map_size) - 1)),
+                                 room.y, true);
             break;
         case 1: // Y
-            move_amount =
-                static_cast<int>(std::round(std::normal_distribution<double>(0, 3)(rng)));
-            room.y = std::clamp(static_cast<int>(room.y) + move_amount, 0,
-                                static_cast<int>(map_size) - 1);
+            move_amount = static_cast<int>(std::round(rng.normal(0, 3)));
+            room.y = skip_frozen(frozen, room.y,
+                                 static_cast<unsigned int>(
+                                     std::clamp(static_cast<int>(room.y) + move_amount, 0,
+                                                static_cast<int>(map_size) - 1)),
+                                 room.x, false);
             break;
         case 2: // Width
-            move_amount =
-                static_cast<int>(std::round(std::normal_distribution<double>(0, 3)(rng)));
+            move_amount = static_cast<int>(std::round(rng.normal(0, 3)));
             for (auto &door : room.door_xs)
             {
                 if (door == room.width)
@@ -192,8 +271,7 @@ std::vector<Room> permute(const std::vector<Room> &input, Generator &rng)
 
             break;
         case 3: // Height
-            move_amount =
-                static_cast<int>(std::round(std::normal_distribution<double>(0, 3)(rng)));
+            move_amount = static_cast<int>(std::round(rng.normal(0, 3)));
             for (auto &door : room.door_ys)
             {
                 if (door == room.height)
@@ -204,14 +282,13 @@ std::vector<Room> permute(const std::vector<Room> &input, Generator &rng)
             room.height = std::clamp(static_cast<int>(room.height) + move_amount, 4, 15);
             break;
         case 4: // Number of doors
-            door_choice = std::uniform_int_distribution<unsigned int>(0, 3)(rng);
+            door_choice = rng.below(4);
             room.doors_active[door_choice] = !room.doors_active[door_choice];
             break;
         case 5: // Door position
-            door_choice = std::uniform_int_distribution<unsigned int>(0, 3)(rng);
-            move_amount =
-                static_cast<int>(std::round(std::normal_distribution<double>(0, 3)(rng)));
-            const int horizontal = std::uniform_int_distribution<int>(0, 1)(rng);
+            door_choice = rng.below(4);
+            move_amount = static_cast<int>(std::round(rng.normal(0, 3)));
+            const auto horizontal = rng.below(2);
             if (horizontal)
             {
                 room.door_xs[door_choice] =
@@ -230,10 +307,8 @@ std::vector<Room> permute(const std::vector<Room> &input, Generator &rng)
     // Swap two nodes
     else
     {
-        unsigned int choice_a = std::uniform_int_distribution<unsigned int>(
-            0, static_cast<unsigned int>(output.size()) - 1)(rng);
-        unsigned int choice_b = std::uniform_int_distribution<unsigned int>(
-            0, static_cast<unsigned int>(output.size()) - 1)(rng);
+        const auto choice_a = rng.index(output.size());
+        auto choice_b = rng.index(output.size());
         if (choice_a == choice_b)
         {
             if (choice_b > 0)
@@ -253,94 +328,541 @@ std::vector<Room> permute(const std::vector<Room> &input, Generator &rng)
     return output;
 }
 
-void run_optimization(const std::vector<RoomConfig> &config)
+std::vector<Room> permute(const std::vector<Room> &input, Rng &rng)
 {
-    std::random_device device;
+    static const OperatorSelector selector(room_operator_names, room_operator_probabilities, false);
+    return permute(input, rng, selector.select(rng), nullptr);
+}
 
-    const auto color_map = config_to_color_map(config);
+std::vector<Node> GenomeTraits<std::vector<Node>>::generate(const std::vector<RoomConfig> &config,
+                                                            Rng &rng, const FrozenMask *frozen)
+{
+    return generate_random_tree(config, rng, frozen);
+}
+
+std::vector<Node> GenomeTraits<std::vector<Node>>::permute(const std::vector<Node> &genome,
+                                                           const std::vector<RoomConfig> &config,
+                                                           Rng &rng, std::size_t mutation,
+                                                           const FrozenMask *frozen)
+{
+    return rlo::permute(genome, config, rng, mutation, frozen);
+}
 
-    auto nodes = generate_random_tree(config);
-    float score = evaluate(Map(map_size, nodes), config);
+OperatorSelector GenomeTraits<std::vector<Node>>::make_selector(bool adaptive)
+{
+    return OperatorSelector(node_operator_names, node_operator_probabilities, adaptive);
+}
+
+std::vector<Room> GenomeTraits<std::vector<Room>>::generate(const std::vector<RoomConfig> &config,
+                                                            Rng &rng, const FrozenMask *frozen)
+{
+    return generate_random_rooms(config, rng, frozen);
+}
+
+std::vector<Room> GenomeTraits<std::vector<Room>>::permute(const std::vector<Room> &genome,
+                                                           const std::vector<RoomConfig> &,
+                                                           Rng &rng, std::size_t mutation,
+                                                           const FrozenMask *frozen)
+{
+    return rlo::permute(genome, rng, mutation, frozen);
+}
 
-    float threshold = 100000.f;
-    float lambda = 0.5f;
-    int phase = 1;
+OperatorSelector GenomeTraits<std::vector<Room>>::make_selector(bool adaptive)
+{
+    return OperatorSelector(room_operator_names, room_operator_probabilities, adaptive);
+}
 
-    const int iterations = 1000;
-    for (int i = 0; i < iterations; i++)
+template <class Genome>
+unsigned int run_steps(Genome &genome, float &score, float threshold, unsigned int steps,
+                       const EvaluationTables &tables, Rng &rng, OperatorSelector &selector,
+                       const EvaluationParallelism &parallelism, unsigned int speculation,
+                       Surrogate *surrogate, DistanceCache *distances)
+{
+    const auto &config = tables.config();
+    const auto *frozen = tables.frozen();
+    // An adapting selector changes its probabilities after every proposal is scored, so the
+    // next proposal can't be drawn ahead of time. A surrogate learns from every evaluation in
+    // turn, and what it would skip is cheaper than a wasted speculative evaluation anyway. A
+    // distance cache repairs one proposal's fields at a time.
+    const unsigned int width = selector.adaptive() || surrogate != nullptr ||
+                                       distances != nullptr || parallelism.pool == nullptr
+                                   ? 1
+                                   : std::max(speculation, 1u);
+
+    struct Proposal
     {
-        std::cout << std::to_string(static_cast<float>(i) / iterations * 100.f) << "%\n";
-        std::cout << "Phase: " << std::to_string(phase) << "\n";
-        std::cout << "Threshold: " << std::to_string(threshold) << "\n";
-        std::cout << "Score: " << std::to_string(score) << "\n";
-        std::cout << "---\n";
-        const auto bmp = Map(map_size, nodes).to_bitmap(color_map);
-        bmp.save_image("output/" + std::to_string(i) + ".bmp");
+        Genome genome;
+        std::size_t mutation;
+        float score;
+        double seconds;
+        bool skipped;
+        // The random stream as it was straight after drawing this proposal
+        Rng rng;
+    };
+    std::vector<Proposal> proposals;
+    unsigned int accepted = 0;
+    unsigned int step = 0;
+    while (step < steps)
+    {
+        // Every proposal in a round starts from the same state, exactly as the serial walk would
+        // draw them if all but the last were rejected
+        const auto round = std::min(width, steps - step);
+        proposals.clear();
+        for (unsigned int k = 0; k < round; k++)
+        {
+            const auto number_of_permutations = 1 + rng.below(3);
+            auto new_genome = genome;
+            std::size_t mutation = 0;
+            for (unsigned int i = 0; i < number_of_permutations; i++)
+            {
+                mutation = selector.select(rng);
+                new_genome = GenomeTraits<Genome>::permute(genome, config, rng, mutation, frozen);
+            }
+            proposals.push_back({std::move(new_genome), mutation, 0.f, 0., false, rng});
+        }
 
-        std::vector<std::future<std::pair<std::vector<Node>, float>>> futures;
-        for (int thread = 0; thread < 16; thread++)
+        const auto score_proposal = [&](std::size_t k) {
+            auto &proposal = proposals[k];
+            const auto map = GenomeTraits<Genome>::rasterize(proposal.genome, frozen);
+            // Acceptance needs score - proposal.score < threshold
+            if (surrogate != nullptr &&
+                surrogate->screen(map, tables, score - threshold) == Screening::skip)
+            {
+                proposal.skipped = true;
+                return;
+            }
+            const auto evaluation_start = std::chrono::steady_clock::now();
+            proposal.score = distances != nullptr ? evaluate(map, tables, *distances, parallelism)
+                                                  : evaluate(map, tables, parallelism);
+            const std::chrono::duration<double> evaluation_time =
+                std::chrono::steady_clock::now() - evaluation_start;
+            proposal.seconds = evaluation_time.count();
+            if (surrogate != nullptr)
+            {
+                surrogate->record(proposal.score, proposal.seconds);
+            }
+        };
+        if (round == 1)
+        {
+            score_proposal(0);
+        }
+        else
         {
-            futures.emplace_back(std::async(
-                [](std::vector<Node> starting_rooms, float starting_score,
-                   std::vector<RoomConfig> config, float threshold, int seed) {
-                    std::mt19937 rng(seed);
-
-                    float score = starting_score;
-                    auto nodes = starting_rooms;
-
-                    for (int j = 0; j < 1000; j++)
-                    {
-                        const int number_of_permutations =
-                            std::uniform_int_distribution<int>(1, 3)(rng);
-                        auto new_nodes = nodes;
-                        for (int i = 0; i < number_of_permutations; i++)
-                        {
-                            new_nodes = permute(nodes, config, rng);
-                        }
-                        float new_score = evaluate(Map(map_size, new_nodes), config);
-                        if (score - new_score < threshold)
-                        {
-                            score = new_score;
-                            nodes = new_nodes;
-                        }
-                    }
-
-                    return std::make_pair(nodes, score);
-                },
-                nodes, score, config, threshold, device() + i));
+            parallelism.pool->parallel_for(0, round, score_proposal, round);
         }
 
-        score = -std::numeric_limits<float>::infinity();
+        // Take the first acceptable proposal and rewind the stream to just after it, dropping
+        // the ones drawn behind it as if they never were
+        for (auto &proposal : proposals)
+        {
+            step++;
+            if (proposal.skipped)
+            {
+                continue;
+            }
+            // Only the last permutation survives into the proposal, so it gets the credit
+            selector.record(proposal.mutation, proposal.score - score, proposal.seconds);
+            if (score - proposal.score < threshold)
+            {
+                score = proposal.score;
+                genome = std::move(proposal.genome);
+                rng = proposal.rng;
+                accepted++;
+                if (distances != nullptr)
+                {
+                    distances->accept();
+                }
+                break;
+            }
+        }
+    }
+    return accepted;
+}
+
+template <class Genome>
+OptimizationResult<Genome> run_optimization(const std::vector<RoomConfig> &config,
+                                            const OptimizationOptions &options,
+                                            const std::vector<Genome> &initial_layouts)
+{
+    auto &pool = ThreadPool::shared();
+    const EvaluationParallelism parallelism{&pool, options.evaluation_threads};
+    const auto *frozen = options.frozen.get();
+    const EvaluationTables tables(config, frozen, options.arithmetic);
+
+    const auto color_map = config_to_color_map(config);
 
-        for (auto &future : futures)
+    Rng stream(options.seed == 0 ? random_seed() : options.seed);
+    auto starting_layouts = initial_layouts;
+    if (starting_layouts.empty())
+    {
+        starting_layouts.push_back(GenomeTraits<Genome>::generate(config, stream, frozen));
+    }
+    std::vector<float> starting_scores;
+    for (const auto &layout : starting_layouts)
+    {
+        starting_scores.push_back(
+            evaluate(GenomeTraits<Genome>::rasterize(layout, frozen), tables));
+    }
+    const auto best_start = static_cast<std::size_t>(
+        std::max_element(starting_scores.begin(), starting_scores.end()) - starting_scores.begin());
+    BestBoard<Genome> board(starting_layouts[best_start], starting_scores[best_start]);
+
+    const std::shared_ptr<const Schedule> schedule =
+        options.schedule ? options.schedule : std::make_shared<PhasedSchedule>(options.iterations);
+
+    // Every chain runs `iterations` blocks of its own, so chains that only get a thread once
+    // others have finished still run in full. Schedules follow the fraction of the chain's
+    // blocks run so far, or of the time budget used up when running to a deadline, rescaled to
+    // start at start_progress.
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto progress_at = [&](std::size_t block) {
+        double fraction =
+            static_cast<double>(block) / static_cast<double>(std::max(options.iterations, 1u));
+        if (options.time_budget > 0)
+        {
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start_time;
+            fraction = elapsed.count() / options.time_budget;
+        }
+        return options.start_progress + (1. - options.start_progress) * fraction;
+    };
+    // The first chain to start each block reports it as that epoch
+    std::atomic<std::size_t> epochs_reported(0);
+    std::atomic<std::size_t> evaluations(starting_layouts.size());
+    std::mutex report_mutex;
+    const auto report = [&](std::size_t epoch, double progress, float threshold) {
+        if (!options.report_progress && !options.on_progress)
+        {
+            return;
+        }
+        const auto *best = board.snapshot();
+        const auto map = GenomeTraits<Genome>::rasterize(best->value, frozen);
+        std::lock_guard<std::mutex> lock(report_mutex);
+        if (options.on_progress)
         {
-            const auto result = future.get();
-            if (result.second > score)
+            options.on_progress({epoch, progress, threshold, best->score, map});
+        }
+        if (options.report_progress)
+        {
+            std::cout << std::to_string(progress * 100.) << "%\n";
+            std::cout << "Threshold: " << std::to_string(threshold) << "\n";
+            std::cout << "Score: " << std::to_string(best->score) << "\n";
+            std::cout << "---\n";
+            const auto bmp = map.to_bitmap(color_map);
+            bmp.save_image(options.output_directory + "/" + std::to_string(epoch) + ".bmp");
+        }
+    };
+
+    // Chains run until their block budget is used up, publishing to the board after every block
+    // and pulling from it whenever someone else has found something better. No chain ever waits
+    // for another. Each chain draws from its own jump of one seeded generator, so the random
+    // streams don't depend on which thread ends up running which chain.
+    std::vector<Rng> rngs;
+    for (unsigned int chain = 0; chain < options.chains; chain++)
+    {
+        rngs.push_back(stream);
+        stream.jump();
+    }
+    std::vector<OperatorSelector> selectors(
+        options.chains, GenomeTraits<Genome>::make_selector(options.adaptive_operators));
+    std::vector<Surrogate> surrogates(options.chains, Surrogate(options.surrogate_options));
+    DistanceCacheStatistics distance_statistics;
+    const auto run_chain = [&](std::size_t chain) {
+        // Everything the chain touches per step is copied on the thread running it, so when the
+        // pool's threads are placed on NUMA nodes it is first touched on, and stays on, the
+        // chain's own node
+        auto rng = rngs[chain];
+        const auto chain_schedule = schedule->clone();
+        auto selector = selectors[chain];
+        auto surrogate = surrogates[chain];
+        DistanceCache distance_cache;
+        const auto chain_config = config;
+        // The frozen analysis is shared rather than worked out again for every chain
+        const EvaluationTables chain_tables(chain_config, tables);
+
+        auto genome = starting_layouts[chain % starting_layouts.size()];
+        float score = starting_scores[chain % starting_layouts.size()];
+        std::uint64_t seen_version = 0;
+
+        for (std::size_t block = 0;; block++)
+        {
+            const auto progress = progress_at(block);
+            if (progress >= 1. || (options.cancel && options.cancel->load()))
+            {
+                break;
+            }
+            const float threshold = chain_schedule->threshold(progress);
+            auto epoch = block;
+            if (epochs_reported.compare_exchange_strong(epoch, block + 1))
+            {
+                report(block, progress, threshold);
+            }
+
+            if (board.version() != seen_version)
+            {
+                const auto *best = board.snapshot();
+                seen_version = best->version;
+                if (best->score > score)
+                {
+                    genome = best->value;
+                    score = best->score;
+                }
+            }
+
+            const auto skipped = surrogate.statistics().skipped;
+            const auto accepted =
+                run_steps(genome, score, threshold, options.steps_per_iteration, chain_tables, rng,
+                          selector, parallelism, options.speculation,
+                          options.surrogate ? &surrogate : nullptr,
+                          options.incremental_distances ? &distance_cache : nullptr);
+            evaluations += options.steps_per_iteration - (surrogate.statistics().skipped - skipped);
+
+            board.publish(genome, score);
+            chain_schedule->record(
+                {options.steps_per_iteration, accepted, board.version() != seen_version});
+        }
+        selectors[chain] = std::move(selector);
+        surrogates[chain] = std::move(surrogate);
+        std::lock_guard<std::mutex> lock(report_mutex);
+        distance_statistics.merge(distance_cache.statistics());
+    };
+    pool.parallel_for(0, options.chains, run_chain, options.chains);
+
+    const auto *best = board.snapshot();
+    if (options.report_progress)
+    {
+        print_operator_statistics(selectors);
+        if (options.surrogate)
+        {
+            SurrogateStatistics surrogate_statistics;
+            for (const auto &surrogate : surrogates)
             {
-                nodes = result.first;
-                score = result.second;
+                surrogate_statistics.merge(surrogate.statistics());
             }
+            std::cout << "Surrogate: skipped " << surrogate_statistics.skipped << " of "
+                      << surrogate_statistics.candidates << " proposals, missed "
+                      << surrogate_statistics.misses << " of " << surrogate_statistics.audited
+                      << " audited (" << std::to_string(surrogate_statistics.miss_rate() * 100.)
+                      << "%), " << std::to_string(surrogate_statistics.speedup())
+                      << "x faster than evaluating them all\n";
         }
+        if (options.incremental_distances)
+        {
+            const auto repairs = std::max<std::size_t>(distance_statistics.repaired, 1);
+            std::cout << "Distance fields: repaired " << distance_statistics.repaired
+                      << ", searched " << distance_statistics.searched
+                      << " from scratch, repairs touched "
+                      << distance_statistics.repaired_tiles / repairs << " tiles on average\n";
+        }
+        std::cout << "100%\n";
+        std::cout << "Score: " << std::to_string(best->score) << "\n";
+        std::cout << "---\n";
+    }
+    const auto bmp = GenomeTraits<Genome>::rasterize(best->value, frozen).to_bitmap(color_map);
+    bmp.save_image(options.output_directory + "/final.bmp");
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    return {best->value, best->score, evaluations.load(), elapsed.count()};
+}
+
+template unsigned int run_steps(std::vector<Node> &genome, float &score, float threshold,
+                                unsigned int steps, const EvaluationTables &tables, Rng &rng,
+                                OperatorSelector &selector,
+                                const EvaluationParallelism &parallelism,
+                                unsigned int speculation, Surrogate *surrogate,
+                                DistanceCache *distances);
+template unsigned int run_steps(std::vector<Room> &genome, float &score, float threshold,
+                                unsigned int steps, const EvaluationTables &tables, Rng &rng,
+                                OperatorSelector &selector,
+                                const EvaluationParallelism &parallelism,
+                                unsigned int speculation, Surrogate *surrogate,
+                                DistanceCache *distances);
+template OptimizationResult<std::vector<Node>>
+run_optimization(const std::vector<RoomConfig> &config, const OptimizationOptions &options,
+                 const std::vector<std::vector<Node>> &initial_layouts);
+template OptimizationResult<std::vector<Room>>
+run_optimization(const std::vector<RoomConfig> &config, const OptimizationOptions &options,
+                 const std::vector<std::vector<Room>> &initial_layouts);
+
+TEST_CASE("BestBoard")
+{
+    SUBCASE("Only accepts improvements")
+    {
+        BestBoard<int> board(1, 10.f);
 
-        threshold *= lambda;
+        CHECK(!board.publish(2, 5.f));
+        CHECK(board.publish(3, 20.f));
+        CHECK(board.snapshot()->value == 3);
+        CHECK(board.version() == 2);
+    }
+
+    SUBCASE("Keeps the best of many concurrent publishers")
+    {
+        BestBoard<int> board;
+        ThreadPool pool(4);
+        pool.parallel_for(
+            0, 1000,
+            [&](std::size_t i) { board.publish(static_cast<int>(i), static_cast<float>(i)); }, 4);
+
+        CHECK(board.snapshot()->value == 999);
+        CHECK(board.snapshot()->score == 999.f);
+    }
+}
 
-        if (phase == 1 && threshold <= 100)
+TEST_CASE("Speculative steps")
+{
+    const auto config = read_config_from_file("config.yml");
+    const EvaluationTables tables(config);
+    ThreadPool pool(4);
+    Rng start_rng(8);
+    const auto start = generate_random_tree(config, start_rng);
+    const auto start_score = evaluate(GenomeTraits<std::vector<Node>>::rasterize(start), tables);
+
+    SUBCASE("End in exactly the state the serial walk does")
+    {
+        for (const float threshold : {0.f, 200.f})
         {
-            lambda = 0.95f;
-            phase = 2;
+            auto serial = start;
+            auto serial_score = start_score;
+            Rng serial_rng(9);
+            auto serial_selector = GenomeTraits<std::vector<Node>>::make_selector(false);
+            const auto serial_accepted = run_steps(serial, serial_score, threshold, 30, tables,
+                                                   serial_rng, serial_selector, {&pool, 1});
+
+            auto speculative = start;
+            auto speculative_score = start_score;
+            Rng speculative_rng(9);
+            auto speculative_selector = GenomeTraits<std::vector<Node>>::make_selector(false);
+            const auto speculative_accepted =
+                run_steps(speculative, speculative_score, threshold, 30, tables, speculative_rng,
+                          speculative_selector, {&pool, 1}, 4);
+
+            CHECK(speculative_accepted == serial_accepted);
+            CHECK(speculative_score == serial_score);
+            const auto speculative_map = GenomeTraits<std::vector<Node>>::rasterize(speculative);
+            const auto serial_map = GenomeTraits<std::vector<Node>>::rasterize(serial);
+            CHECK(std::equal(speculative_map.data().begin(), speculative_map.data().end(),
+                             serial_map.data().begin()));
+            CHECK(speculative_rng() == serial_rng());
+            for (std::size_t i = 0; i < serial_selector.statistics().size(); i++)
+            {
+                CHECK(speculative_selector.statistics()[i].uses ==
+                      serial_selector.statistics()[i].uses);
+            }
         }
-        else if (phase == 2 && threshold <= 0.5f)
+    }
+}
+
+namespace
+{
+// Counts the chains that run at least one block, through the clone each of them owns
+class CountingSchedule : public Schedule
+{
+  private:
+    std::shared_ptr<std::atomic<unsigned int>> m_chains;
+    bool m_counted = false;
+
+  public:
+    explicit CountingSchedule(std::shared_ptr<std::atomic<unsigned int>> chains)
+        : m_chains(std::move(chains))
+    {
+    }
+
+    float threshold(double) override { return 0.f; }
+    void record(const BlockStatistics &) override
+    {
+        if (!m_counted)
+        {
+            m_counted = true;
+            (*m_chains)++;
+        }
+    }
+    std::unique_ptr<Schedule> clone() const override
+    {
+        return std::make_unique<CountingSchedule>(m_chains);
+    }
+};
+}
+
+TEST_CASE("run_optimization()")
+{
+    SUBCASE("Every chain runs its whole budget, however few threads are free")
+    {
+        const auto config = read_config_from_file("config.yml");
+        const auto chains_run = std::make_shared<std::atomic<unsigned int>>(0);
+        OptimizationOptions options;
+        // More chains than threads, so some only start once others have finished
+        options.chains = 2 * (ThreadPool::shared().size() + 1);
+        options.iterations = 2;
+        options.steps_per_iteration = 1;
+        options.seed = 3;
+        options.report_progress = false;
+        options.output_directory = std::filesystem::temp_directory_path().string();
+        options.schedule = std::make_shared<CountingSchedule>(chains_run);
+        const auto result = run_optimization<std::vector<Node>>(config, options);
+        std::filesystem::remove(std::filesystem::temp_directory_path() / "final.bmp");
+
+        CHECK(chains_run->load() == options.chains);
+        CHECK(result.evaluations == 1 + options.chains * 2);
+    }
+}
+
+TEST_CASE("Frozen masks")
+{
+    const auto config = read_config_from_file("config.yml");
+    // Everything but a strip down the middle of the map is frozen wall
+    std::vector<unsigned char> tiles(map_size * map_size, wall);
+    for (unsigned int y = 0; y < map_size; y++)
+    {
+        std::fill(tiles.begin() + y * map_size + 40, tiles.begin() + y * map_size + 60, floor);
+    }
+    const FrozenMask frozen(map_size, {tiles.data(), tiles.size()});
+    Rng rng(3);
+
+    SUBCASE("Keep tree nodes off frozen tiles")
+    {
+        auto nodes = generate_random_tree(config, rng, &frozen);
+        for (int i = 0; i < 2000; i++)
         {
-            threshold = 200.f;
-            phase = 3;
+            nodes = permute(nodes, config, rng, &frozen);
         }
+
+        CHECK(std::none_of(nodes.begin(), nodes.end(),
+                           [&](const Node &node) { return frozen.contains(node.x, node.y); }));
     }
 
-    std::cout << "100%\n";
-    std::cout << "Threshold: " << std::to_string(threshold) << "\n";
-    std::cout << "Score: " << std::to_string(score) << "\n";
-    std::cout << "---\n";
-    const auto bmp = Map(map_size, nodes).to_bitmap(color_map);
-    bmp.save_image("output/final.bmp");
+    SUBCASE("Keep room corners off frozen tiles")
+    {
+        using Traits = GenomeTraits<std::vector<Room>>;
+        auto rooms = Traits::generate(config, rng, &frozen);
+        for (int i = 0; i < 2000; i++)
+        {
+            rooms = Traits::permute(rooms, config, rng, adjust_room, &frozen);
+        }
+
+        CHECK(std::none_of(rooms.begin(), rooms.end(),
+                           [&](const Room &room) { return frozen.contains(room.x, room.y); }));
+    }
+
+    SUBCASE("Leave the frozen tiles of every layout the run returns alone")
+    {
+        OptimizationOptions options;
+        options.chains = 1;
+        options.iterations = 2;
+        options.steps_per_iteration = 2;
+        options.seed = 5;
+        options.report_progress = false;
+        options.output_directory = std::filesystem::temp_directory_path().string();
+        options.frozen = std::make_shared<FrozenMask>(frozen);
+        const auto result = run_optimization<std::vector<Node>>(config, options);
+        std::filesystem::remove(std::filesystem::temp_directory_path() / "final.bmp");
+        const auto map = GenomeTraits<std::vector<Node>>::rasterize(result.best, &frozen);
+
+        CHECK(std::equal(map.data().begin(), map.data().end(), tiles.begin(),
+                         [](unsigned char tile, unsigned char frozen_tile) {
+                             return frozen_tile == floor || tile == frozen_tile;
+                         }));
+        CHECK(evaluate(map, config) == result.score);
+    }
 }
 }
\ No newline at end of file
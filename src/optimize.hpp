@@ -1,6 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "config.hpp"
+#include "evaluate.hpp"
+#include "frozen.hpp"
+#include "map.hpp"
+#include "operator_selector.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+#include "surrogate.hpp"
 
 namespace rlo
 {
-void run_optimization(const std::vector<RoomConfig> &config);
+constexpr unsigned int map_size = 100;
+
+struct ProgressReport
+{
+    std::size_t epoch;
+    double progress;
+    float threshold;
+    float score;
+    // The best layout found so far
+    const Map &best;
+};
+
+struct OptimizationOptions
+{
+    // Each chain runs `iterations` blocks of its own, however many of them get a thread at once
+    unsigned int chains = 16;
+    unsigned int iterations = 1000;
+    // Proposals each chain makes between checks of the shared best solution
+    unsigned int steps_per_iteration = 1000;
+    // Threads each evaluation may use for its per-room distance searches. These are only
+    // borrowed from workers the chains leave idle, so raising this is cheap when chains < cores.
+    unsigned int evaluation_threads = 1;
+    // Cloned for every chain. Defaults to the phased schedule over `iterations`.
+    std::shared_ptr<const Schedule> schedule;
+    // When non-zero, the run ends after this many seconds instead of after `iterations`, and
+    // the schedule's progress follows the wall clock
+    double time_budget = 0;
+    // Learn which mutation operators are paying off and favour them, rather than always using
+    // the fixed mix
+    bool adaptive_operators = false;
+    // Proposals each chain draws from its current state and scores at once on workers the chains
+    // leave idle, accepting the first that passes. Late in a run, when nearly every proposal is
+    // rejected, this lets a single chain use several cores. Runs end up exactly as they would
+    // with 1, except that adaptive_operators turns it off.
+    unsigned int speculation = 1;
+    // Fixed point scores come out exactly the same however evaluations are split up or
+    // reordered, at the cost of rounding costs, weights and terms
+    ScoreArithmetic arithmetic = ScoreArithmetic::floating_point;
+    // Screen every proposal with a partial evaluation and a model of the distances learnt as the
+    // chain goes, skipping the full evaluation of ones it is confident would be rejected. This
+    // turns speculation off.
+    bool surrogate = false;
+    SurrogateOptions surrogate_options;
+    // Keep each chain's per-room distance fields and repair them for every proposal, rather than
+    // searching them from scratch. Scores come out exactly the same. This turns speculation off.
+    bool incremental_distances = false;
+    // Where on the schedule the run starts, for continuing from layouts that have already had
+    // some of the budget spent on them
+    double start_progress = 0;
+    // Seeds every chain's random stream; 0 picks a random seed. A seeded run with one chain
+    // always comes out the same. With several, when a chain takes up a better layout another one
+    // published depends on timing, so only each chain's own stream is reproducible.
+    std::uint64_t seed = 0;
+    // Where the progress snapshots and final.bmp are saved. It must already exist.
+    std::string output_directory = "output";
+    // Print a report and save a snapshot at the start of every epoch
+    bool report_progress = true;
+    // Called at the start of every epoch, on whichever thread starts it
+    std::function<void(const ProgressReport &)> on_progress;
+    // Chains stop at their next block boundary once this is set, and the run returns the best
+    // layout found so far
+    const std::atomic<bool> *cancel = nullptr;
+    // Tiles every layout keeps as they are. It must be map_size across.
+    std::shared_ptr<const FrozenMask> frozen;
+};
+
+template <class Genome>
+struct OptimizationResult
+{
+    Genome best;
+    float score;
+    // Every layout scored, including the starting ones
+    std::size_t evaluations;
+    double seconds;
+};
+
+// Nodes and room corners are never placed on a tile of `frozen`
+std::vector<Node> generate_random_tree(const std::vector<RoomConfig> &config, Rng &rng,
+                                       const FrozenMask *frozen = nullptr);
+std::vector<Room> generate_random_rooms(const std::vector<RoomConfig> &config, Rng &rng,
+                                        const FrozenMask *frozen = nullptr);
+
+// Applies one randomly chosen mutation
+std::vector<Node> permute(const std::vector<Node> &input, const std::vector<RoomConfig> &config,
+                          Rng &rng, const FrozenMask *frozen = nullptr);
+
+// Everything the optimizer needs to know about a layout representation: how to make a random
+// one, how to mutate it and how to turn it into a map for evaluation. Each takes an optional
+// frozen mask: generated and mutated layouts keep their nodes or rooms off its tiles, and
+// rasterized maps keep its tiles as they are.
+template <class Genome>
+struct GenomeTraits;
+
+// Nodes split the map into rooms as a K-D tree, so every layout covers the whole map
+template <>
+struct GenomeTraits<std::vector<Node>>
+{
+    static constexpr const char *name = "tree";
+
+    static std::vector<Node> generate(const std::vector<RoomConfig> &config, Rng &rng,
+                                      const FrozenMask *frozen = nullptr);
+    static std::vector<Node> permute(const std::vector<Node> &genome,
+                                     const std::vector<RoomConfig> &config, Rng &rng,
+                                     std::size_t mutation, const FrozenMask *frozen = nullptr);
+    static OperatorSelector make_selector(bool adaptive);
+    static inline Map rasterize(const std::vector<Node> &genome,
+                                const FrozenMask *frozen = nullptr)
+    {
+        return Map(map_size, genome, frozen);
+    }
+};
+
+// Free-standing rectangles, one per room the config asks for. Rasterizing only touches the tiles
+// the rectangles cover, which is much cheaper than building a tree for sparse layouts.
+template <>
+struct GenomeTraits<std::vector<Room>>
+{
+    static constexpr const char *name = "rooms";
+
+    static std::vector<Room> generate(const std::vector<RoomConfig> &config, Rng &rng,
+                                      const FrozenMask *frozen = nullptr);
+    static std::vector<Room> permute(const std::vector<Room> &genome,
+                                     const std::vector<RoomConfig> &config, Rng &rng,
+                                     std::size_t mutation, const FrozenMask *frozen = nullptr);
+    static OperatorSelector make_selector(bool adaptive);
+    static inline Map rasterize(const std::vector<Room> &genome,
+                                const FrozenMask *frozen = nullptr)
+    {
+        return Map(map_size, genome, frozen);
+    }
+};
+
+// Makes `steps` threshold-accepting proposals starting from genome/score, updating both in place,
+// keeping to the tables' frozen mask if they have one. Returns how many proposals were accepted.
+// With speculation above 1 it draws that many proposals from the current state at once and
+// scores them together on the pool's idle workers (unless the selector adapts), ending in
+// exactly the same state as making them one at a time. With a surrogate, every proposal is
+// screened by it first, one at a time, and the ones it skips are rejected without a full
+// evaluation or being recorded with the selector. With a distance cache, proposals are scored
+// one at a time with it, and it accepts along with them. Instantiated for both genomes.
+template <class Genome>
+unsigned int run_steps(Genome &genome, float &score, float threshold, unsigned int steps,
+                       const EvaluationTables &tables, Rng &rng, OperatorSelector &selector,
+                       const EvaluationParallelism &parallelism, unsigned int speculation = 1,
+                       Surrogate *surrogate = nullptr, DistanceCache *distances = nullptr);
+
+// Chain i starts from initial_layouts[i % size], or from a random layout when there are none.
+// Instantiated for both genomes.
+template <class Genome>
+OptimizationResult<Genome> run_optimization(const std::vector<RoomConfig> &config,
+                                            const OptimizationOptions &options = {},
+                                            const std::vector<Genome> &initial_layouts = {});
 }
\ No newline at end of file
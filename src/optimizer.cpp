@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "optimizer.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+#include "thread_pool.hpp"
+
+namespace rlo
+{
+template <class Genome>
+Optimizer<Genome>::Optimizer(std::vector<RoomConfig> config, const OptimizationOptions &options,
+                             const std::vector<Genome> &initial_layouts)
+    : m_config(std::move(config)), m_options(options),
+      m_tables(m_config, m_options.frozen.get(), m_options.arithmetic), m_best(0), m_epoch(0),
+      m_evaluations(0)
+{
+    m_options.chains = std::max(m_options.chains, 1u);
+    if (!m_options.schedule)
+    {
+        m_options.schedule = std::make_shared<PhasedSchedule>(m_options.iterations);
+    }
+
+    Rng stream(m_options.seed == 0 ? random_seed() : m_options.seed);
+    auto starting_layouts = initial_layouts;
+    if (starting_layouts.empty())
+    {
+        starting_layouts.push_back(
+            GenomeTraits<Genome>::generate(m_config, stream, m_options.frozen.get()));
+    }
+    std::vector<float> starting_scores;
+    for (const auto &layout : starting_layouts)
+    {
+        starting_scores.push_back(
+            evaluate(GenomeTraits<Genome>::rasterize(layout, m_options.frozen.get()), m_tables));
+    }
+    m_evaluations = starting_layouts.size();
+
+    for (unsigned int chain = 0; chain < m_options.chains; chain++)
+    {
+        const auto start = chain % starting_layouts.size();
+        m_chains.push_back({starting_layouts[start], starting_scores[start], stream,
+                            GenomeTraits<Genome>::make_selector(m_options.adaptive_operators),
+                            m_options.schedule->clone()});
+        stream.jump();
+        if (m_chains.back().score > m_chains[m_best].score)
+        {
+            m_best = chain;
+        }
+    }
+}
+
+template <class Genome>
+double Optimizer<Genome>::progress() const
+{
+    const double fraction = static_cast<double>(m_epoch) / std::max(m_options.iterations, 1u);
+    return m_options.start_progress + (1. - m_options.start_progress) * fraction;
+}
+
+template <class Genome>
+bool Optimizer<Genome>::step()
+{
+    if (finished())
+    {
+        return false;
+    }
+
+    auto &pool = ThreadPool::shared();
+    const EvaluationParallelism parallelism{&pool, m_options.evaluation_threads};
+    const auto current_progress = progress();
+    const auto previous_best = best_score();
+    std::vector<unsigned int> accepted(m_chains.size(), 0);
+    pool.parallel_for(
+        0, m_chains.size(),
+        [&](std::size_t i) {
+            auto &chain = m_chains[i];
+            const auto threshold = chain.schedule->threshold(current_progress);
+            accepted[i] = run_steps(chain.genome, chain.score, threshold,
+                                    m_options.steps_per_iteration, m_tables, chain.rng,
+                                    chain.selector, parallelism, m_options.speculation);
+        },
+        m_options.chains);
+    m_evaluations += m_chains.size() * m_options.steps_per_iteration;
+
+    for (std::size_t i = 0; i < m_chains.size(); i++)
+    {
+        if (m_chains[i].score > m_chains[m_best].score)
+        {
+            m_best = i;
+        }
+    }
+    const bool improved_best = best_score() > previous_best;
+    for (std::size_t i = 0; i < m_chains.size(); i++)
+    {
+        auto &chain = m_chains[i];
+        chain.schedule->record({m_options.steps_per_iteration, accepted[i], improved_best});
+        if (chain.score < best_score())
+        {
+            chain.genome = best();
+            chain.score = best_score();
+        }
+    }
+
+    m_epoch++;
+    return true;
+}
+
+template class Optimizer<std::vector<Node>>;
+template class Optimizer<std::vector<Room>>;
+
+TEST_CASE("Optimizer")
+{
+    const auto config = read_config_from_file("config.yml");
+    OptimizationOptions options;
+    options.chains = 2;
+    options.iterations = 3;
+    options.steps_per_iteration = 2;
+    options.seed = 7;
+
+    SUBCASE("Steps until the iteration budget is used up, never losing the best score")
+    {
+        Optimizer<std::vector<Node>> optimizer(config, options);
+        const auto starting_score = optimizer.best_score();
+        unsigned int steps = 0;
+        while (optimizer.step())
+        {
+            steps++;
+        }
+
+        CHECK(steps == 3);
+        CHECK(optimizer.finished());
+        CHECK(optimizer.progress() == 1.);
+        CHECK(optimizer.best_score() >= starting_score);
+        CHECK(optimizer.evaluations() == 1 + 2 * 3 * 2);
+        CHECK(evaluate(optimizer.best_map(), config) == optimizer.best_score());
+    }
+
+    SUBCASE("Is reproducible from a seed")
+    {
+        Optimizer<std::vector<Room>> a(config, options);
+        Optimizer<std::vector<Room>> b(config, options);
+        while (a.step() && b.step())
+        {
+        }
+
+        CHECK(a.best_score() == b.best_score());
+    }
+}
+}
\ No newline at end of file
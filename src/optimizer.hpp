@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "operator_selector.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+
+namespace rlo
+{
+// A threshold-accepting run that the caller drives one epoch at a time, for embedding in other
+// programs. Unlike run_optimization() the chains meet at the end of every epoch, where each one
+// that is behind takes over the best layout, so results only depend on the seed. The run ends
+// after options.iterations epochs; the time budget, reporting and output directory are unused.
+// Instantiated for both genomes.
+template <class Genome>
+class Optimizer
+{
+  private:
+    struct Chain
+    {
+        Genome genome;
+        float score;
+        Rng rng;
+        OperatorSelector selector;
+        std::unique_ptr<Schedule> schedule;
+    };
+
+    std::vector<RoomConfig> m_config;
+    OptimizationOptions m_options;
+    // Points at m_config and the options' frozen mask, so optimizers can't be copied or moved
+    EvaluationTables m_tables;
+    std::vector<Chain> m_chains;
+    std::size_t m_best;
+    unsigned int m_epoch;
+    std::size_t m_evaluations;
+
+  public:
+    Optimizer(std::vector<RoomConfig> config, const OptimizationOptions &options = {},
+              const std::vector<Genome> &initial_layouts = {});
+    Optimizer(const Optimizer &) = delete;
+    Optimizer &operator=(const Optimizer &) = delete;
+
+    // Runs one block of proposals on every chain. Returns false without doing anything once the
+    // run is over.
+    bool step();
+
+    double progress() const;
+    inline bool finished() const { return m_epoch >= m_options.iterations; }
+    inline const Genome &best() const { return m_chains[m_best].genome; }
+    inline float best_score() const { return m_chains[m_best].score; }
+    inline Map best_map() const
+    {
+        return GenomeTraits<Genome>::rasterize(best(), m_options.frozen.get());
+    }
+    inline std::size_t evaluations() const { return m_evaluations; }
+};
+}
\ No newline at end of file
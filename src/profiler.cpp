@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <doctest/doctest.h>
+
+#include "profiler.hpp"
+
+namespace rlo
+{
+namespace
+{
+const std::array<const char *, profile_stage_count> stage_names{"rasterize", "costmap",
+                                                                "analyze_rooms", "distance_map"};
+
+std::atomic<bool> profiling(false);
+
+struct ThreadProfile
+{
+    unsigned int index = 0;
+    // Reading the leader reads the whole group at once
+    int leader = -1;
+    // Which counter each value of a group read belongs to, in the order they were opened
+    std::vector<std::size_t> opened;
+    std::array<bool, profile_counter_count> available{};
+    std::mutex mutex;
+    std::array<StageProfile, profile_stage_count> stages;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadProfile>> threads;
+};
+
+// Never destroyed, so the report can still be printed from an atexit() handler
+Registry &registry()
+{
+    static auto *registry = new Registry;
+    return *registry;
+}
+
+int open_counter(std::uint64_t config, int group)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0));
+}
+
+// Opened on first use and kept for the life of the thread. Each counter that the kernel refuses
+// (no PMU in a VM, perf_event_paranoid too strict, ...) is just left out of the group.
+ThreadProfile &thread_profile()
+{
+    thread_local std::shared_ptr<ThreadProfile> profile;
+    if (!profile)
+    {
+        profile = std::make_shared<ThreadProfile>();
+        const std::array<std::uint64_t, profile_counter_count> configs{
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES};
+        for (std::size_t counter = 0; counter < profile_counter_count; counter++)
+        {
+            const int descriptor = open_counter(configs[counter], profile->leader);
+            if (descriptor < 0)
+            {
+                continue;
+            }
+            if (profile->leader < 0)
+            {
+                profile->leader = descriptor;
+            }
+            profile->opened.push_back(counter);
+            profile->available[counter] = true;
+        }
+
+        auto &threads = registry();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        profile->index = static_cast<unsigned int>(threads.threads.size());
+        threads.threads.push_back(profile);
+    }
+    return *profile;
+}
+
+std::array<std::uint64_t, profile_counter_count> read_counters(const ThreadProfile &profile)
+{
+    std::array<std::uint64_t, profile_counter_count> values{};
+    if (profile.leader < 0)
+    {
+        return values;
+    }
+    // A group read gives the number of counters followed by their values
+    std::array<std::uint64_t, profile_counter_count + 1> buffer{};
+    if (read(profile.leader, buffer.data(), sizeof(buffer)) <
+        static_cast<ssize_t>(sizeof(std::uint64_t)))
+    {
+        return values;
+    }
+    const auto count = std::min<std::size_t>(buffer[0], profile.opened.size());
+    for (std::size_t i = 0; i < count; i++)
+    {
+        values[profile.opened[i]] = buffer[i + 1];
+    }
+    return values;
+}
+
+void add_stage(StageProfile &total, const StageProfile &stage)
+{
+    if (stage.calls == 0)
+    {
+        return;
+    }
+    total.calls += stage.calls;
+    total.seconds += stage.seconds;
+    for (std::size_t counter = 0; counter < profile_counter_count; counter++)
+    {
+        total.counters[counter] += stage.counters[counter];
+        total.available[counter] = total.available[counter] && stage.available[counter];
+    }
+}
+
+std::string describe_stage(const StageProfile &stage)
+{
+    std::stringstream description;
+    description << stage.calls << " calls, " << std::to_string(stage.seconds) << "s";
+    const auto instructions = static_cast<double>(stage.counters[ProfileCounter::instructions]);
+    if (stage.available[cycles] && stage.available[ProfileCounter::instructions] &&
+        stage.counters[cycles] > 0)
+    {
+        description << ", IPC "
+                    << std::to_string(instructions / static_cast<double>(stage.counters[cycles]));
+    }
+    if (stage.available[ProfileCounter::instructions] && instructions > 0)
+    {
+        const auto per_kilo_instruction = [&](ProfileCounter counter) {
+            return std::to_string(static_cast<double>(stage.counters[counter]) * 1000. /
+                                  instructions);
+        };
+        if (stage.available[cache_misses])
+        {
+            description << ", " << per_kilo_instruction(cache_misses) << " cache MPKI";
+        }
+        if (stage.available[branch_misses])
+        {
+            description << ", " << per_kilo_instruction(branch_misses) << " branch MPKI";
+        }
+    }
+    return description.str();
+}
+}
+
+void set_profiling(bool enabled)
+{
+    profiling.store(enabled);
+}
+
+bool profiling_enabled()
+{
+    return profiling.load(std::memory_order_relaxed);
+}
+
+ProfileScope::ProfileScope(ProfileStage stage)
+    : m_stage(stage), m_active(profiling_enabled()), m_start{}
+{
+    if (m_active)
+    {
+        m_start_time = std::chrono::steady_clock::now();
+        m_start = read_counters(thread_profile());
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (!m_active)
+    {
+        return;
+    }
+    auto &profile = thread_profile();
+    const auto end = read_counters(profile);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_start_time;
+
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    auto &stage = profile.stages[static_cast<std::size_t>(m_stage)];
+    stage.calls++;
+    stage.seconds += elapsed.count();
+    for (std::size_t counter = 0; counter < profile_counter_count; counter++)
+    {
+        stage.counters[counter] += end[counter] - m_start[counter];
+    }
+    stage.available = profile.available;
+}
+
+std::array<StageProfile, profile_stage_count> profile_totals()
+{
+    std::array<StageProfile, profile_stage_count> totals;
+    auto &threads = registry();
+    std::lock_guard<std::mutex> registry_lock(threads.mutex);
+    for (const auto &thread : threads.threads)
+    {
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        for (std::size_t stage = 0; stage < profile_stage_count; stage++)
+        {
+            add_stage(totals[stage], thread->stages[stage]);
+        }
+    }
+    return totals;
+}
+
+void print_profile(std::ostream &stream)
+{
+    const auto totals = profile_totals();
+    stream << "Profile:\n";
+    const bool any_counters = std::any_of(totals.begin(), totals.end(), [](const auto &stage) {
+        return stage.calls > 0 && std::any_of(stage.available.begin(), stage.available.end(),
+                                              [](bool available) { return available; });
+    });
+    if (!any_counters)
+    {
+        stream << "  Hardware counters unavailable, showing time only\n";
+    }
+    for (std::size_t stage = 0; stage < profile_stage_count; stage++)
+    {
+        stream << "  " << stage_names[stage] << ": " << describe_stage(totals[stage]) << "\n";
+    }
+
+    auto &threads = registry();
+    std::lock_guard<std::mutex> registry_lock(threads.mutex);
+    for (const auto &thread : threads.threads)
+    {
+        std::lock_guard<std::mutex> lock(thread->mutex);
+        stream << "  Thread " << thread->index << ":\n";
+        for (std::size_t stage = 0; stage < profile_stage_count; stage++)
+        {
+            if (thread->stages[stage].calls > 0)
+            {
+                stream << "    " << stage_names[stage] << ": "
+                       << describe_stage(thread->stages[stage]) << "\n";
+            }
+        }
+    }
+}
+
+TEST_CASE("ProfileScope")
+{
+    const auto before = profile_totals();
+
+    SUBCASE("Records nothing while profiling is off")
+    {
+        {
+            ProfileScope scope(ProfileStage::costmap);
+        }
+
+        CHECK(profile_totals()[1].calls == before[1].calls);
+    }
+
+    SUBCASE("Counts calls and time, with or without hardware counters")
+    {
+        set_profiling(true);
+        volatile std::uint64_t sum = 0;
+        {
+            ProfileScope scope(ProfileStage::analyze_rooms);
+            for (std::uint64_t i = 0; i < 100000; i++)
+            {
+                sum = sum + i;
+            }
+        }
+        set_profiling(false);
+        const auto after = profile_totals()[2];
+
+        CHECK(after.calls == before[2].calls + 1);
+        CHECK(after.seconds > before[2].seconds);
+        if (after.available[ProfileCounter::instructions])
+        {
+            CHECK(after.counters[ProfileCounter::instructions] >
+                  before[2].counters[ProfileCounter::instructions]);
+        }
+
+        std::stringstream report;
+        print_profile(report);
+        CHECK(report.str().find("analyze_rooms: ") != std::string::npos);
+    }
+}
+}
\ No newline at end of file
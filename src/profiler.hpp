@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace rlo
+{
+enum class ProfileStage : std::size_t
+{
+    rasterize,
+    costmap,
+    analyze_rooms,
+    distance_map
+};
+constexpr std::size_t profile_stage_count = 4;
+
+enum ProfileCounter : std::size_t
+{
+    cycles,
+    instructions,
+    cache_misses,
+    branch_misses
+};
+constexpr std::size_t profile_counter_count = 4;
+
+struct StageProfile
+{
+    std::uint64_t calls = 0;
+    double seconds = 0;
+    std::array<std::uint64_t, profile_counter_count> counters{};
+    // Whether each counter could be opened on every thread that ran the stage
+    std::array<bool, profile_counter_count> available{true, true, true, true};
+};
+
+// Profiling is off until this turns it on, and scopes cost a single flag check while it's off
+void set_profiling(bool enabled);
+bool profiling_enabled();
+
+// Adds the time and hardware events (cycles, instructions, last level cache misses and branch
+// misses) spent on the calling thread while it lives to `stage`. Counters are opened with
+// perf_event_open() the first time each thread profiles anything; where the kernel won't allow
+// that, only calls and time are recorded.
+class ProfileScope
+{
+  private:
+    ProfileStage m_stage;
+    bool m_active;
+    std::array<std::uint64_t, profile_counter_count> m_start;
+    std::chrono::steady_clock::time_point m_start_time;
+
+  public:
+    explicit ProfileScope(ProfileStage stage);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+// Totals for each stage across every thread that has profiled anything
+std::array<StageProfile, profile_stage_count> profile_totals();
+
+// Per-stage IPC and misses per thousand instructions, for all threads and then for each one
+void print_profile(std::ostream &stream);
+}
\ No newline at end of file
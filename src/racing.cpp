@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "racing.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "operator_selector.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+#include "schedule.hpp"
+#include "thread_pool.hpp"
+
+namespace rlo
+{
+template <class Genome>
+struct Candidate
+{
+    Genome genome;
+    float score;
+    Rng rng;
+    OperatorSelector selector;
+    std::unique_ptr<Schedule> schedule;
+};
+
+std::vector<Rung> plan_rungs(unsigned int starts, unsigned int survivors, unsigned int reduction,
+                             unsigned int first_rung_steps)
+{
+    std::vector<Rung> rungs;
+    survivors = std::max(survivors, 1u);
+    reduction = std::max(reduction, 2u);
+    unsigned int candidates = starts;
+    unsigned int steps = first_rung_steps;
+    while (candidates > survivors)
+    {
+        rungs.push_back({candidates, steps});
+        candidates = std::max(survivors, (candidates + reduction - 1) / reduction);
+        steps *= reduction;
+    }
+    return rungs;
+}
+
+template <class Genome>
+void run_racing(const std::vector<RoomConfig> &config, const OptimizationOptions &options,
+                const RacingOptions &racing)
+{
+    auto &pool = ThreadPool::shared();
+    const auto *frozen = options.frozen.get();
+    const EvaluationTables tables(config, frozen, options.arithmetic);
+    Rng stream(options.seed == 0 ? random_seed() : options.seed);
+    const std::shared_ptr<const Schedule> schedule =
+        options.schedule ? options.schedule : std::make_shared<PhasedSchedule>(options.iterations);
+
+    const auto rungs =
+        plan_rungs(racing.starts, options.chains, racing.reduction, racing.first_rung_steps);
+
+    // The race and the main run share one budget, counted in evaluations
+    double racing_evaluations = 0;
+    for (const auto &rung : rungs)
+    {
+        racing_evaluations += static_cast<double>(rung.candidates) * rung.steps;
+    }
+    const double total_evaluations = racing_evaluations + static_cast<double>(options.iterations) *
+                                                              options.chains *
+                                                              options.steps_per_iteration;
+
+    std::vector<Candidate<Genome>> candidates;
+    for (unsigned int i = 0; i < std::max(racing.starts, 1u); i++)
+    {
+        candidates.push_back({GenomeTraits<Genome>::generate(config, stream, frozen), 0.f, stream,
+                              GenomeTraits<Genome>::make_selector(options.adaptive_operators),
+                              schedule->clone()});
+        stream.jump();
+    }
+    pool.parallel_for(
+        0, candidates.size(),
+        [&](std::size_t i) {
+            candidates[i].score =
+                evaluate(GenomeTraits<Genome>::rasterize(candidates[i].genome, frozen), tables);
+        },
+        pool.size() + 1);
+
+    double evaluations = 0;
+    for (std::size_t r = 0; r < rungs.size(); r++)
+    {
+        const auto &rung = rungs[r];
+        const auto progress = evaluations / total_evaluations;
+        pool.parallel_for(
+            0, candidates.size(),
+            [&](std::size_t i) {
+                auto &candidate = candidates[i];
+                const auto threshold = candidate.schedule->threshold(progress);
+                const auto accepted =
+                    run_steps(candidate.genome, candidate.score, threshold, rung.steps, tables,
+                              candidate.rng, candidate.selector, {});
+                candidate.schedule->record({rung.steps, accepted, false});
+            },
+            pool.size() + 1);
+        evaluations += static_cast<double>(rung.candidates) * rung.steps;
+
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate<Genome> &lhs, const Candidate<Genome> &rhs) {
+                      return lhs.score > rhs.score;
+                  });
+        const auto keep = r + 1 < rungs.size() ? rungs[r + 1].candidates
+                                               : std::min<std::size_t>(options.chains,
+                                                                       candidates.size());
+        std::cout << "Rung " << std::to_string(r) << ": " << std::to_string(rung.candidates)
+                  << " candidates, " << std::to_string(rung.steps) << " steps each, best "
+                  << std::to_string(candidates.front().score) << ", worst kept "
+                  << std::to_string(candidates[keep - 1].score) << "\n";
+        candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(keep),
+                         candidates.end());
+    }
+
+    std::vector<Genome> survivors;
+    for (const auto &candidate : candidates)
+    {
+        survivors.push_back(candidate.genome);
+    }
+    auto main_options = options;
+    main_options.start_progress = evaluations / total_evaluations;
+    // Seeding the main run from the race's generator keeps a seeded race reproducible end to end,
+    // as far as the main run is (see OptimizationOptions::seed)
+    main_options.seed = stream();
+    run_optimization(config, main_options, survivors);
+}
+
+template void run_racing<std::vector<Node>>(const std::vector<RoomConfig> &config,
+                                            const OptimizationOptions &options,
+                                            const RacingOptions &racing);
+template void run_racing<std::vector<Room>>(const std::vector<RoomConfig> &config,
+                                            const OptimizationOptions &options,
+                                            const RacingOptions &racing);
+
+TEST_CASE("plan_rungs()")
+{
+    SUBCASE("Halves the field and doubles the steps until the survivors are left")
+    {
+        const auto rungs = plan_rungs(64, 16, 2, 100);
+
+        REQUIRE(rungs.size() == 2);
+        CHECK(rungs[0].candidates == 64);
+        CHECK(rungs[0].steps == 100);
+        CHECK(rungs[1].candidates == 32);
+        CHECK(rungs[1].steps == 200);
+    }
+
+    SUBCASE("Stops once another cut would drop below the number of survivors")
+    {
+        const auto rungs = plan_rungs(40, 8, 3, 10);
+
+        REQUIRE(rungs.size() == 2);
+        CHECK(rungs[1].candidates == 14);
+        CHECK(rungs[1].steps == 30);
+    }
+
+    SUBCASE("Doesn't race when there are no more starts than survivors")
+    {
+        CHECK(plan_rungs(16, 16, 2, 100).empty());
+    }
+}
+}
\ No newline at end of file
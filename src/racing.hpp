@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "config.hpp"
+#include "optimize.hpp"
+
+namespace rlo
+{
+struct RacingOptions
+{
+    unsigned int starts = 64;
+    // Each rung keeps the best 1 / reduction of its candidates and gives the next rung
+    // `reduction` times as many proposals per candidate
+    unsigned int reduction = 2;
+    unsigned int first_rung_steps = 100;
+};
+
+struct Rung
+{
+    unsigned int candidates;
+    unsigned int steps;
+};
+
+// Successive halving from `starts` candidates down to `survivors`
+std::vector<Rung> plan_rungs(unsigned int starts, unsigned int survivors, unsigned int reduction,
+                             unsigned int first_rung_steps);
+
+// Races many random starts against each other with successive halving, then hands the survivors
+// to run_optimization() as its chains' starting layouts. The schedule's clock covers both stages,
+// so the main run picks up where the race left off. Instantiated for both genomes.
+template <class Genome>
+void run_racing(const std::vector<RoomConfig> &config, const OptimizationOptions &options,
+                const RacingOptions &racing = {});
+}
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "reference.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "tests.hpp"
+#include "utils.hpp"
+
+namespace rlo
+{
+namespace
+{
+typedef std::pair<unsigned int, unsigned int> Tile;
+
+struct ReferenceRoom
+{
+    unsigned char type;
+    std::vector<Tile> tiles;
+    unsigned int center_x;
+    unsigned int center_y;
+    unsigned int width;
+    unsigned int height;
+};
+
+std::vector<Tile> fill_room(std::vector<unsigned char> &tiles, unsigned int size, Tile start)
+{
+    std::vector<Tile> room;
+    const auto type = tiles[start.second * size + start.first];
+    std::queue<Tile> queue;
+    queue.push(start);
+    while (!queue.empty())
+    {
+        const auto tile = queue.front();
+        queue.pop();
+        if (tile.first >= size || tile.second >= size ||
+            tiles[tile.second * size + tile.first] != type)
+        {
+            continue;
+        }
+        room.push_back(tile);
+        tiles[tile.second * size + tile.first] = floor;
+        // Stepping left of 0 or above 0 wraps around and fails the bounds check
+        queue.push({tile.first - 1, tile.second});
+        queue.push({tile.first + 1, tile.second});
+        queue.push({tile.first, tile.second - 1});
+        queue.push({tile.first, tile.second + 1});
+    }
+    return room;
+}
+
+ReferenceRoom describe(unsigned char type, std::vector<Tile> tiles)
+{
+    unsigned int min_x = std::numeric_limits<unsigned int>::max();
+    unsigned int min_y = std::numeric_limits<unsigned int>::max();
+    unsigned int max_x = 0;
+    unsigned int max_y = 0;
+    double x_sum = 0;
+    double y_sum = 0;
+    for (const auto &tile : tiles)
+    {
+        min_x = std::min(min_x, tile.first);
+        min_y = std::min(min_y, tile.second);
+        max_x = std::max(max_x, tile.first);
+        max_y = std::max(max_y, tile.second);
+        x_sum += tile.first;
+        y_sum += tile.second;
+    }
+
+    // The room's own tile closest to its centroid, preferring the topmost then leftmost on ties
+    const auto centroid_x = std::round(x_sum / static_cast<double>(tiles.size()));
+    const auto centroid_y = std::round(y_sum / static_cast<double>(tiles.size()));
+    double closest = std::numeric_limits<double>::infinity();
+    Tile center{0, 0};
+    for (const auto &tile : tiles)
+    {
+        const auto dx = tile.first - centroid_x;
+        const auto dy = tile.second - centroid_y;
+        const auto distance = dx * dx + dy * dy;
+        if (distance < closest ||
+            (distance == closest && std::make_pair(tile.second, tile.first) <
+                                        std::make_pair(center.second, center.first)))
+        {
+            closest = distance;
+            center = tile;
+        }
+    }
+    return {type, std::move(tiles), center.first, center.second, max_x + 1 - min_x,
+            max_y + 1 - min_y};
+}
+
+float movement_cost(unsigned char tile, const std::vector<RoomConfig> &config)
+{
+    if (tile == wall)
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    if (tile == door)
+    {
+        return door_move_cost;
+    }
+    if (tile < config.size())
+    {
+        return config[tile].movement_cost;
+    }
+    return 1.f;
+}
+
+// Cheapest cost of reaching every tile from anywhere in the room, where a path pays the movement
+// cost of each tile it enters after leaving the room
+std::vector<float> room_distances(const Map &map, const std::vector<RoomConfig> &config,
+                                  const ReferenceRoom &room)
+{
+    const auto size = map.size();
+    std::vector<float> costs(size * size);
+    for (unsigned int i = 0; i < size * size; i++)
+    {
+        costs[i] = movement_cost(map.get(i % size, i / size), config);
+    }
+
+    typedef std::pair<unsigned int, float> Entry;
+    const auto later = [](const Entry &lhs, const Entry &rhs) { return lhs.second > rhs.second; };
+    std::priority_queue<Entry, std::vector<Entry>, decltype(later)> queue(later);
+    std::vector<float> distances(size * size, std::numeric_limits<float>::infinity());
+    std::vector<bool> settled(size * size, false);
+    const auto push_neighbours = [&](unsigned int index, float cost) {
+        // index > size rather than >= size, exactly as evaluate() has it
+        const std::pair<bool, unsigned int> neighbours[] = {
+            {index > size, index - size},
+            {index < size * size - size, index + size},
+            {index % size > 0, index - 1},
+            {index % size < size - 1, index + 1}};
+        for (const auto &[exists, neighbour] : neighbours)
+        {
+            if (exists && costs[neighbour] != std::numeric_limits<float>::infinity())
+            {
+                queue.push({neighbour, cost});
+            }
+        }
+    };
+
+    for (const auto &tile : room.tiles)
+    {
+        distances[tile.second * size + tile.first] = 0.f;
+        settled[tile.second * size + tile.first] = true;
+    }
+    for (const auto &tile : room.tiles)
+    {
+        push_neighbours(tile.second * size + tile.first, 0.f);
+    }
+    while (!queue.empty())
+    {
+        const auto entry = queue.top();
+        queue.pop();
+        if (settled[entry.first])
+        {
+            continue;
+        }
+        settled[entry.first] = true;
+        distances[entry.first] = entry.second + costs[entry.first];
+        push_neighbours(entry.first, distances[entry.first]);
+    }
+    return distances;
+}
+}
+
+float reference_evaluate(const Map &map, const std::vector<RoomConfig> &config)
+{
+    const auto size = map.size();
+
+    // Rooms are numbered in the order a column by column scan first reaches them
+    std::vector<ReferenceRoom> rooms;
+    std::vector<unsigned char> tiles(map.data().begin(), map.data().end());
+    for (unsigned int x = 0; x < size; x++)
+    {
+        for (unsigned int y = 0; y < size; y++)
+        {
+            const auto type = tiles[y * size + x];
+            if (type < floor)
+            {
+                rooms.push_back(describe(type, fill_room(tiles, size, {x, y})));
+            }
+        }
+    }
+
+    float score = 0.f;
+    for (const auto &room : rooms)
+    {
+        if (room.tiles.size() < 9)
+        {
+            score -= 100.f;
+            continue;
+        }
+        const auto &room_config = config[room.type];
+
+        if (room.tiles.size() < room_config.minimum_size)
+        {
+            score -= 1000.f;
+        }
+        else if (room.tiles.size() < room_config.minimum_size * 4)
+        {
+            score += static_cast<float>(room.tiles.size() - room_config.minimum_size) *
+                     room_config.size_scaling;
+        }
+
+        score -= static_cast<float>(
+                     std::abs(static_cast<short>(room.width) - static_cast<short>(room.height))) *
+                 10.f;
+        if (room.width < 3 || room.height < 3)
+        {
+            score -= 100.f;
+        }
+
+        score -= static_cast<float>(room.width * room.height -
+                                    static_cast<int>(room.tiles.size()));
+
+        const auto distances = room_distances(map, config, room);
+        for (const auto &target : rooms)
+        {
+            const auto weight = room_config.weights.find(target.type);
+            if (weight == room_config.weights.end())
+            {
+                continue;
+            }
+            const auto distance = distances[target.center_y * size + target.center_x];
+            if (distance == std::numeric_limits<float>::infinity())
+            {
+                score -= 500.f;
+            }
+            else
+            {
+                score -= distance * weight->second;
+            }
+        }
+    }
+
+    for (std::size_t type = 0; type < config.size(); type++)
+    {
+        unsigned int count = 0;
+        for (const auto &room : rooms)
+        {
+            if (room.tiles.size() >= 9 && room.type == type)
+            {
+                count++;
+            }
+        }
+        if (count != config[type].count)
+        {
+            score -= 15000.f * static_cast<float>(std::abs(static_cast<int>(count) -
+                                                           static_cast<int>(config[type].count)));
+        }
+    }
+
+    for (const auto tile : map.data())
+    {
+        if (tile == wall)
+        {
+            score -= wall_cost;
+        }
+        else if (tile == door)
+        {
+            score -= door_cost;
+        }
+    }
+    return score;
+}
+
+TEST_CASE("reference_evaluate()")
+{
+    const auto config = read_config_from_file("config.yml");
+
+    SUBCASE("Scores an empty map by its missing rooms alone")
+    {
+        const Map map(100, std::vector<Room>{});
+        float expected = 0.f;
+        for (const auto &room_config : config)
+        {
+            expected -= 15000.f * static_cast<float>(room_config.count);
+        }
+
+        CHECK(reference_evaluate(map, config) == expected);
+        CHECK(evaluate(map, config) == expected);
+    }
+
+    SUBCASE("Agrees with evaluate() on hand-built rooms")
+    {
+        const Map map(100, sample_rooms());
+
+        CHECK(reference_evaluate(map, config) == evaluate(map, config));
+    }
+}
+}
\ No newline at end of file
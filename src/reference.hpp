@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+#include "config.hpp"
+#include "map.hpp"
+
+namespace rlo
+{
+// The scoring rules of evaluate() written out as plainly as possible: a queue-based flood fill
+// for each room, a fresh std::priority_queue search for each room's distances, config lookups
+// through its hash maps and no shortcuts, scratch buffers or parallelism. It is much slower than
+// evaluate() and only exists to check it against, so any change to the rules has to be made in
+// both.
+float reference_evaluate(const Map &map, const std::vector<RoomConfig> &config);
+}
\ No newline at end of file
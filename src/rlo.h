@@ -0,0 +1,56 @@
+#ifndef RLO_H
+#define RLO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* C interface to the rlo library, for scoring and optimizing layouts in-process. Functions that
+ * can fail return NULL or a negative number and leave a message for rlo_last_error(), which is
+ * also how NULL arguments are reported. Handles may be used from any thread, but not from two
+ * threads at once. */
+
+typedef struct rlo_config rlo_config;
+typedef struct rlo_optimizer rlo_optimizer;
+
+/* The message for the last failure on this thread, or "" */
+const char *rlo_last_error(void);
+
+/* Side length of the maps the optimizer produces */
+unsigned int rlo_map_size(void);
+
+rlo_config *rlo_config_load(const char *path);
+rlo_config *rlo_config_parse(const char *yaml);
+void rlo_config_free(rlo_config *config);
+
+/* Scores size * size row-major tiles, read in place from the caller's buffer, into *score.
+ * Returns 0, or -1 on failure, including when a tile isn't floor (253), a door (254), a wall
+ * (255) or one of the config's room types. */
+int rlo_evaluate(const rlo_config *config, const unsigned char *tiles, unsigned int size,
+                 float *score);
+/* Scores count maps stored back to back in tiles into scores[0..count), spreading them over the
+ * library's thread pool. Returns 0, or -1 on failure, with the same checks on the tiles. */
+int rlo_evaluate_batch(const rlo_config *config, const unsigned char *tiles, size_t count,
+                       unsigned int size, float *scores);
+
+/* genome is "tree" or "rooms". A seed of 0 picks a random one. The optimizer keeps its own copy
+ * of the config. */
+rlo_optimizer *rlo_optimizer_create(const rlo_config *config, const char *genome,
+                                    unsigned int chains, unsigned int iterations,
+                                    unsigned int steps_per_iteration, uint64_t seed);
+/* Runs one epoch. Returns 1 if it did, 0 once the run is over and -1 on failure. */
+int rlo_optimizer_step(rlo_optimizer *optimizer);
+double rlo_optimizer_progress(const rlo_optimizer *optimizer);
+float rlo_optimizer_best_score(const rlo_optimizer *optimizer);
+/* Writes the best layout's rlo_map_size() squared tiles to the caller's buffer */
+int rlo_optimizer_best_tiles(const rlo_optimizer *optimizer, unsigned char *tiles, size_t length);
+void rlo_optimizer_free(rlo_optimizer *optimizer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+
+#include <doctest/doctest.h>
+
+#include "rng.hpp"
+
+namespace rlo
+{
+Rng::Rng(std::uint64_t seed) : m_normals{}, m_next_normal(normal_batch)
+{
+    // splitmix64 spreads even small or similar seeds over the whole state, which also
+    // guarantees the state isn't all zeros
+    for (auto &word : m_state)
+    {
+        seed += 0x9e3779b97f4a7c15;
+        auto z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        word = z ^ (z >> 31);
+    }
+}
+
+void Rng::refill_normals()
+{
+    constexpr double two_pi = 6.283185307179586;
+    for (std::size_t i = 0; i < normal_batch; i += 2)
+    {
+        // 1 - uniform() is in (0, 1], so the log is always finite
+        const double radius = std::sqrt(-2. * std::log(1. - uniform()));
+        const double angle = two_pi * uniform();
+        m_normals[i] = static_cast<float>(radius * std::cos(angle));
+        m_normals[i + 1] = static_cast<float>(radius * std::sin(angle));
+    }
+    m_next_normal = 0;
+}
+
+void Rng::jump()
+{
+    constexpr std::array<std::uint64_t, 4> jump_polynomial{
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+
+    std::array<std::uint64_t, 4> state{0, 0, 0, 0};
+    for (const auto word : jump_polynomial)
+    {
+        for (int bit = 0; bit < 64; bit++)
+        {
+            if (word & (std::uint64_t{1} << bit))
+            {
+                for (std::size_t i = 0; i < state.size(); i++)
+                {
+                    state[i] ^= m_state[i];
+                }
+            }
+            operator()();
+        }
+    }
+    m_state = state;
+    m_next_normal = normal_batch;
+}
+
+std::uint64_t random_seed()
+{
+    std::random_device device;
+    return (std::uint64_t{device()} << 32) ^ device();
+}
+
+TEST_CASE("Rng")
+{
+    SUBCASE("Matches the reference xoshiro256** and splitmix64 output")
+    {
+        Rng rng(0);
+
+        CHECK(rng() == 0x99ec5f36cb75f2b4);
+        CHECK(rng() == 0xbf6e1f784956452a);
+        CHECK(rng() == 0x1a5f849d4933e6e0);
+    }
+
+    SUBCASE("Jumped streams are reproducible and distinct")
+    {
+        Rng a(42);
+        Rng b(42);
+        std::set<std::uint64_t> firsts;
+        for (int i = 0; i < 8; i++)
+        {
+            a.jump();
+            b.jump();
+            auto copy = a;
+            firsts.insert(copy());
+        }
+
+        CHECK(a() == b());
+        CHECK(firsts.size() == 8);
+    }
+
+    SUBCASE("Bounded draws stay in range and cover it")
+    {
+        Rng rng(1);
+        std::array<int, 7> counts{};
+        for (int i = 0; i < 7000; i++)
+        {
+            const auto value = rng.below(7);
+            REQUIRE(value < 7);
+            counts[value]++;
+        }
+
+        for (const auto count : counts)
+        {
+            CHECK(count > 850);
+            CHECK(count < 1150);
+        }
+    }
+
+    SUBCASE("Normal draws have the requested mean and deviation")
+    {
+        Rng rng(2);
+        constexpr int samples = 100000;
+        double sum = 0;
+        double sum_of_squares = 0;
+        for (int i = 0; i < samples; i++)
+        {
+            const double value = rng.normal(3.f, 5.f);
+            sum += value;
+            sum_of_squares += value * value;
+        }
+        const double mean = sum / samples;
+        const double variance = sum_of_squares / samples - mean * mean;
+
+        CHECK(mean == doctest::Approx(3.).epsilon(0.02));
+        CHECK(std::sqrt(variance) == doctest::Approx(5.).epsilon(0.02));
+    }
+}
+}
\ No newline at end of file
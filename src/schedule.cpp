@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "schedule.hpp"
+
+namespace rlo
+{
+PhasedSchedule::PhasedSchedule(unsigned int iterations)
+{
+    float threshold = 100000.f;
+    float lambda = 0.5f;
+    int phase = 1;
+    for (unsigned int i = 0; i < std::max(iterations, 1u); i++)
+    {
+        m_thresholds.push_back(threshold);
+
+        threshold *= lambda;
+
+        if (phase == 1 && threshold <= 100)
+        {
+            lambda = 0.95f;
+            phase = 2;
+        }
+        else if (phase == 2 && threshold <= 0.5f)
+        {
+            threshold = 200.f;
+            phase = 3;
+        }
+    }
+}
+
+float PhasedSchedule::threshold(double progress)
+{
+    const auto iteration = static_cast<std::size_t>(
+        std::clamp(progress, 0., 1.) * static_cast<double>(m_thresholds.size()));
+    return m_thresholds[std::min(iteration, m_thresholds.size() - 1)];
+}
+
+std::unique_ptr<Schedule> PhasedSchedule::clone() const
+{
+    return std::make_unique<PhasedSchedule>(*this);
+}
+
+AdaptiveSchedule::AdaptiveSchedule(float initial_threshold, double initial_acceptance,
+                                   double final_acceptance, double gain)
+    : m_threshold(initial_threshold),
+      m_initial_acceptance(initial_acceptance),
+      m_final_acceptance(final_acceptance),
+      m_gain(gain),
+      m_progress(0)
+{
+}
+
+float AdaptiveSchedule::threshold(double progress)
+{
+    m_progress = std::clamp(progress, 0., 1.);
+    return m_threshold;
+}
+
+void AdaptiveSchedule::record(const BlockStatistics &statistics)
+{
+    if (statistics.proposals == 0)
+    {
+        return;
+    }
+    const double target =
+        m_initial_acceptance * std::pow(m_final_acceptance / m_initial_acceptance, m_progress);
+    const double measured =
+        static_cast<double>(statistics.accepted) / static_cast<double>(statistics.proposals);
+    // Relative error, clamped so a single odd block can't move the threshold more than e-fold
+    const double error = std::clamp((target - measured) / target, -1., 1.);
+    m_threshold = std::max(m_threshold * static_cast<float>(std::exp(m_gain * error)), 1e-3f);
+}
+
+std::unique_ptr<Schedule> AdaptiveSchedule::clone() const
+{
+    return std::make_unique<AdaptiveSchedule>(*this);
+}
+
+ReheatingSchedule::ReheatingSchedule(std::unique_ptr<Schedule> inner, unsigned int patience,
+                                     float reheat_factor, float cooldown)
+    : m_inner(std::move(inner)),
+      m_patience(patience),
+      m_reheat_factor(reheat_factor),
+      m_cooldown(cooldown),
+      m_stagnant_blocks(0),
+      m_boost(1.f)
+{
+}
+
+float ReheatingSchedule::threshold(double progress)
+{
+    return m_inner->threshold(progress) * m_boost;
+}
+
+void ReheatingSchedule::record(const BlockStatistics &statistics)
+{
+    m_inner->record(statistics);
+
+    m_boost = 1.f + (m_boost - 1.f) * m_cooldown;
+    m_stagnant_blocks = statistics.improved_best ? 0 : m_stagnant_blocks + 1;
+    // Reheating sets the boost rather than multiplying it, since a boost that hasn't faded out by
+    // the next reheat would otherwise compound without bound
+    if (m_stagnant_blocks >= m_patience)
+    {
+        m_boost = m_reheat_factor;
+        m_stagnant_blocks = 0;
+    }
+}
+
+std::unique_ptr<Schedule> ReheatingSchedule::clone() const
+{
+    return std::make_unique<ReheatingSchedule>(m_inner->clone(), m_patience, m_reheat_factor,
+                                               m_cooldown);
+}
+
+std::unique_ptr<Schedule> make_schedule(const std::string &name, unsigned int iterations,
+                                        unsigned int reheat_patience)
+{
+    std::unique_ptr<Schedule> schedule;
+    if (name == "phased")
+    {
+        schedule = std::make_unique<PhasedSchedule>(iterations);
+    }
+    else if (name == "adaptive")
+    {
+        schedule = std::make_unique<AdaptiveSchedule>();
+    }
+    else
+    {
+        throw std::runtime_error("Unknown schedule: " + name);
+    }
+
+    if (reheat_patience > 0)
+    {
+        schedule = std::make_unique<ReheatingSchedule>(std::move(schedule), reheat_patience);
+    }
+    return schedule;
+}
+
+TEST_CASE("Schedules")
+{
+    SUBCASE("PhasedSchedule")
+    {
+        PhasedSchedule schedule(1000);
+
+        SUBCASE("Starts at 100000 and halves every iteration")
+        {
+            CHECK(schedule.threshold(0.) == 100000.f);
+            CHECK(schedule.threshold(0.001) == 50000.f);
+        }
+
+        SUBCASE("Reheats to 200 once the second phase has cooled off")
+        {
+            const auto thresholds = [&] {
+                std::vector<float> thresholds;
+                for (int i = 0; i < 1000; i++)
+                {
+                    thresholds.push_back(schedule.threshold(i / 1000.));
+                }
+                return thresholds;
+            }();
+
+            CHECK(std::find(thresholds.begin(), thresholds.end(), 200.f) != thresholds.end());
+        }
+
+        SUBCASE("Holds the last threshold at the end of the run")
+        {
+            CHECK(schedule.threshold(1.) == schedule.threshold(0.9999));
+        }
+    }
+
+    SUBCASE("AdaptiveSchedule")
+    {
+        AdaptiveSchedule schedule(100.f, 0.5, 0.5);
+
+        SUBCASE("Cools down when too much is accepted")
+        {
+            schedule.threshold(0.);
+            schedule.record({100, 90, false});
+
+            CHECK(schedule.threshold(0.) < 100.f);
+        }
+
+        SUBCASE("Heats up when too little is accepted")
+        {
+            schedule.threshold(0.);
+            schedule.record({100, 10, false});
+
+            CHECK(schedule.threshold(0.) > 100.f);
+        }
+
+        SUBCASE("Holds steady on target")
+        {
+            schedule.threshold(0.);
+            schedule.record({100, 50, false});
+
+            CHECK(schedule.threshold(0.) == doctest::Approx(100.f));
+        }
+    }
+
+    SUBCASE("ReheatingSchedule")
+    {
+        ReheatingSchedule schedule(std::make_unique<PhasedSchedule>(1), 2, 10.f, 0.5f);
+
+        SUBCASE("Reheats after the patience runs out")
+        {
+            schedule.record({1, 0, false});
+
+            CHECK(schedule.threshold(0.) == 100000.f);
+
+            schedule.record({1, 0, false});
+
+            CHECK(schedule.threshold(0.) == 1000000.f);
+        }
+
+        SUBCASE("Improvements reset the patience")
+        {
+            schedule.record({1, 0, false});
+            schedule.record({1, 0, true});
+            schedule.record({1, 0, false});
+
+            CHECK(schedule.threshold(0.) == 100000.f);
+        }
+
+        SUBCASE("Never boosts by more than the reheat factor")
+        {
+            float highest = 0.f;
+            for (int i = 0; i < 1000; i++)
+            {
+                schedule.record({1, 0, false});
+                highest = std::max(highest, schedule.threshold(0.));
+            }
+
+            CHECK(highest == 1000000.f);
+        }
+    }
+
+    SUBCASE("make_schedule() rejects unknown names")
+    {
+        CHECK_THROWS(make_schedule("geometric", 1000, 0));
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rlo
+{
+// What one chain saw during one block of proposals
+struct BlockStatistics
+{
+    unsigned int proposals;
+    unsigned int accepted;
+    // Whether the shared best solution got better while the block ran
+    bool improved_best;
+};
+
+// Decides the acceptance threshold for each block of proposals. Every chain owns its own clone,
+// so implementations may keep per-chain state without locking. Progress runs from 0 to 1 on the
+// chain's own clock (its blocks run so far, or wall-clock time when running to a deadline).
+class Schedule
+{
+  public:
+    virtual ~Schedule() = default;
+
+    virtual float threshold(double progress) = 0;
+    virtual void record(const BlockStatistics &) {}
+    virtual std::unique_ptr<Schedule> clone() const = 0;
+};
+
+// The original hand-tuned schedule: halve from 100000 until 100, decay by 5% per iteration down
+// to 0.5, then reheat to 200 and decay again
+class PhasedSchedule : public Schedule
+{
+  private:
+    std::vector<float> m_thresholds;
+
+  public:
+    explicit PhasedSchedule(unsigned int iterations);
+
+    float threshold(double progress) override;
+    std::unique_ptr<Schedule> clone() const override;
+};
+
+// Steers the threshold so the fraction of accepted proposals tracks a target that decays
+// geometrically from initial_acceptance to final_acceptance over the run
+class AdaptiveSchedule : public Schedule
+{
+  private:
+    float m_threshold;
+    double m_initial_acceptance;
+    double m_final_acceptance;
+    double m_gain;
+    double m_progress;
+
+  public:
+    AdaptiveSchedule(float initial_threshold = 100000.f, double initial_acceptance = 0.5,
+                     double final_acceptance = 0.002, double gain = 0.5);
+
+    float threshold(double progress) override;
+    void record(const BlockStatistics &statistics) override;
+    std::unique_ptr<Schedule> clone() const override;
+};
+
+// Wraps another schedule and multiplies its threshold by `reheat_factor` when the shared best
+// solution hasn't improved for `patience` blocks, letting the boost fade out again over the
+// following blocks
+class ReheatingSchedule : public Schedule
+{
+  private:
+    std::unique_ptr<Schedule> m_inner;
+    unsigned int m_patience;
+    float m_reheat_factor;
+    float m_cooldown;
+    unsigned int m_stagnant_blocks;
+    float m_boost;
+
+  public:
+    ReheatingSchedule(std::unique_ptr<Schedule> inner, unsigned int patience,
+                      float reheat_factor = 10.f, float cooldown = 0.8f);
+
+    float threshold(double progress) override;
+    void record(const BlockStatistics &statistics) override;
+    std::unique_ptr<Schedule> clone() const override;
+};
+
+// Builds a schedule from its command line name ("phased" or "adaptive"), optionally wrapped in
+// stagnation reheating when reheat_patience is non-zero
+std::unique_ptr<Schedule> make_schedule(const std::string &name, unsigned int iterations,
+                                        unsigned int reheat_patience);
+}
\ No newline at end of file
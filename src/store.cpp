@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "store.hpp"
+#include "config.hpp"
+#include "map.hpp"
+#include "mapped_file.hpp"
+#include "optimize.hpp"
+#include "tests.hpp"
+
+namespace rlo
+{
+namespace
+{
+constexpr char store_magic[8] = {'R', 'L', 'O', 'S', 'T', 'O', 'R', '1'};
+
+template <class T>
+void append(std::vector<unsigned char> &buffer, const T &value)
+{
+    const auto offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+// Reads fields out of the mapped store in order, refusing to run off its end
+class Reader
+{
+  private:
+    const unsigned char *m_data;
+    std::size_t m_size;
+    std::size_t m_offset = 0;
+    const std::string &m_path;
+
+  public:
+    Reader(const unsigned char *data, std::size_t size, const std::string &path)
+        : m_data(data), m_size(size), m_path(path)
+    {
+    }
+
+    void skip(std::size_t length)
+    {
+        if (length > m_size - m_offset)
+        {
+            throw std::runtime_error(m_path + " is truncated");
+        }
+        m_offset += length;
+    }
+
+    template <class T>
+    T read()
+    {
+        const auto start = m_offset;
+        skip(sizeof(T));
+        T value;
+        std::memcpy(&value, m_data + start, sizeof(T));
+        return value;
+    }
+
+    inline std::size_t offset() const { return m_offset; }
+};
+}
+
+ResultStore::ResultStore(std::string path) : m_path(std::move(path))
+{
+    load();
+}
+
+void ResultStore::load()
+{
+    m_entries.clear();
+    m_file.reset();
+    if (!std::filesystem::exists(m_path))
+    {
+        return;
+    }
+    m_file = std::make_unique<MappedFile>(m_path);
+
+    Reader reader(m_file->data(), m_file->size(), m_path);
+    char magic[sizeof(store_magic)];
+    for (auto &character : magic)
+    {
+        character = reader.read<char>();
+    }
+    if (!std::equal(std::begin(magic), std::end(magic), std::begin(store_magic)))
+    {
+        throw std::runtime_error(m_path + " isn't a result store");
+    }
+    const auto count = reader.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        Entry entry;
+        entry.offset = reader.offset();
+        entry.fingerprint = reader.read<std::uint64_t>();
+        entry.size = reader.read<std::uint32_t>();
+        entry.score = reader.read<float>();
+        entry.rooms.resize(reader.read<std::uint32_t>());
+        for (auto &room : entry.rooms)
+        {
+            room = reader.read<std::uint64_t>();
+        }
+        entry.tiles_offset = reader.offset();
+        reader.skip(std::size_t{entry.size} * entry.size);
+        entry.length = reader.offset() - entry.offset;
+        m_entries.push_back(std::move(entry));
+    }
+}
+
+StoredLayout ResultStore::read(const Entry &entry, bool exact) const
+{
+    const auto tiles = m_file->data() + entry.tiles_offset;
+    return {entry.fingerprint, entry.score, entry.rooms,
+            std::vector<unsigned char>(tiles, tiles + std::size_t{entry.size} * entry.size),
+            exact};
+}
+
+std::optional<StoredLayout> ResultStore::nearest(const std::vector<RoomConfig> &config,
+                                                 unsigned int size) const
+{
+    const auto fingerprint = config_fingerprint(config, size);
+    std::vector<std::uint64_t> rooms;
+    for (const auto &room : config)
+    {
+        rooms.push_back(room_fingerprint(room));
+    }
+
+    const Entry *best = nullptr;
+    std::size_t best_shared = 0;
+    for (const auto &entry : m_entries)
+    {
+        if (entry.size != size)
+        {
+            continue;
+        }
+        if (entry.fingerprint == fingerprint)
+        {
+            return read(entry, true);
+        }
+        // Tiles name room types by index, so a layout with a different number of types could
+        // hold ones this config doesn't have
+        if (entry.rooms.size() != rooms.size())
+        {
+            continue;
+        }
+        std::size_t shared = 0;
+        for (std::size_t i = 0; i < rooms.size(); i++)
+        {
+            shared += entry.rooms[i] == rooms[i];
+        }
+        // Later entries were saved more recently, so they win ties
+        if (shared > 0 && shared >= best_shared)
+        {
+            best = &entry;
+            best_shared = shared;
+        }
+    }
+    if (best == nullptr)
+    {
+        return std::nullopt;
+    }
+    return read(*best, false);
+}
+
+bool ResultStore::record(const std::vector<RoomConfig> &config, float score, const Map &map)
+{
+    const auto fingerprint = config_fingerprint(config, map.size());
+    const auto existing =
+        std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry &entry) {
+            return entry.fingerprint == fingerprint && entry.size == map.size();
+        });
+    if (existing != m_entries.end() && existing->score >= score)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> contents(std::begin(store_magic), std::end(store_magic));
+    append(contents, static_cast<std::uint32_t>(m_entries.size() + (existing == m_entries.end())));
+    for (auto entry = m_entries.begin(); entry != m_entries.end(); entry++)
+    {
+        if (entry != existing)
+        {
+            const auto start = m_file->data() + entry->offset;
+            contents.insert(contents.end(), start, start + entry->length);
+        }
+    }
+    // The improved layout goes last, which also marks it as the most recent
+    append(contents, fingerprint);
+    append(contents, std::uint32_t{map.size()});
+    append(contents, score);
+    append(contents, static_cast<std::uint32_t>(config.size()));
+    for (const auto &room : config)
+    {
+        append(contents, room_fingerprint(room));
+    }
+    contents.insert(contents.end(), map.data().begin(), map.data().end());
+
+    const auto temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(contents.data()),
+                   static_cast<std::streamsize>(contents.size()));
+        if (!file)
+        {
+            throw std::runtime_error("Couldn't write " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, m_path);
+    load();
+    return true;
+}
+
+TEST_CASE("ResultStore")
+{
+    const auto config = read_config_from_file("config.yml");
+    const auto path = (std::filesystem::temp_directory_path() / "rlo_store_test.bin").string();
+    std::filesystem::remove(path);
+    const auto rooms = sample_rooms();
+    const Map first(map_size, std::vector<Room>{rooms[0]});
+    const Map second(map_size, std::vector<Room>{rooms[1]});
+
+    SUBCASE("Keeps the best layout for each config across reopening")
+    {
+        {
+            ResultStore store(path);
+            CHECK(store.size() == 0);
+            CHECK(!store.nearest(config, map_size));
+
+            CHECK(store.record(config, -10.f, first));
+            CHECK(!store.record(config, -20.f, second));
+        }
+        ResultStore store(path);
+        auto stored = store.nearest(config, map_size);
+        REQUIRE(stored);
+        CHECK(stored->exact);
+        CHECK(stored->score == -10.f);
+        CHECK(stored->tiles == std::vector<unsigned char>(first.data().begin(),
+                                                          first.data().end()));
+
+        CHECK(store.record(config, -5.f, second));
+        CHECK(store.size() == 1);
+        stored = store.nearest(config, map_size);
+        REQUIRE(stored);
+        CHECK(stored->score == -5.f);
+        CHECK(stored->tiles == std::vector<unsigned char>(second.data().begin(),
+                                                          second.data().end()));
+    }
+
+    SUBCASE("Falls back to the config sharing the most room types")
+    {
+        auto slightly_changed = config;
+        slightly_changed[0].minimum_size++;
+        auto very_changed = slightly_changed;
+        for (auto &room : very_changed)
+        {
+            room.count++;
+        }
+        auto fewer_rooms = config;
+        fewer_rooms.pop_back();
+
+        ResultStore store(path);
+        store.record(slightly_changed, -10.f, first);
+        store.record(very_changed, -1.f, second);
+        store.record(fewer_rooms, 0.f, second);
+        const auto stored = store.nearest(config, map_size);
+
+        REQUIRE(stored);
+        CHECK(!stored->exact);
+        CHECK(stored->fingerprint == config_fingerprint(slightly_changed, map_size));
+        CHECK(!store.nearest(config, 50));
+    }
+
+    SUBCASE("Refuses files that aren't stores")
+    {
+        std::ofstream(path) << "not a store";
+
+        CHECK_THROWS(ResultStore{path});
+    }
+    std::filesystem::remove(path);
+}
+}
\ No newline at end of file
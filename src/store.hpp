@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "map.hpp"
+#include "mapped_file.hpp"
+
+namespace rlo
+{
+struct StoredLayout
+{
+    std::uint64_t fingerprint;
+    float score;
+    // room_fingerprint() of each room type of the config the layout was optimized for
+    std::vector<std::uint64_t> rooms;
+    std::vector<unsigned char> tiles;
+    // Whether it was found under this exact config, rather than being the nearest match
+    bool exact;
+};
+
+// The best layout found so far for every config, kept in a file that is memory-mapped while it
+// is open. Only the index is read up front; a layout's tiles are copied out when it's looked up.
+// Saving writes a new file and renames it over the old one, so concurrent runs never see a half
+// written store, although the last of them to save wins.
+class ResultStore
+{
+  private:
+    struct Entry
+    {
+        std::uint64_t fingerprint;
+        unsigned int size;
+        float score;
+        std::vector<std::uint64_t> rooms;
+        // Where the tiles start in the mapping, and where the whole entry does
+        std::size_t tiles_offset;
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    std::string m_path;
+    std::unique_ptr<MappedFile> m_file;
+    std::vector<Entry> m_entries;
+
+    void load();
+    StoredLayout read(const Entry &entry, bool exact) const;
+
+  public:
+    // A store that doesn't exist yet starts empty and is created by the first record()
+    explicit ResultStore(std::string path);
+
+    inline std::size_t size() const { return m_entries.size(); }
+
+    // The layout stored for this exact config. Failing that, the one for the config of the same
+    // map size and number of room types that shares the most room types with it, if any do.
+    std::optional<StoredLayout> nearest(const std::vector<RoomConfig> &config,
+                                        unsigned int size) const;
+
+    // Saves the map as the best for its config unless a layout scoring at least as well already
+    // is. Returns whether it was saved.
+    bool record(const std::vector<RoomConfig> &config, float score, const Map &map);
+};
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "surrogate.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "rng.hpp"
+
+namespace rlo
+{
+namespace
+{
+// Starting scale of the inverse covariance. Large, so the first few evaluations set the weights
+// rather than the zeros they start at.
+constexpr double initial_inverse = 1e4;
+// Once past the warmup, how quickly the error estimate follows the latest errors
+constexpr double error_smoothing = 0.01;
+}
+
+double SurrogateStatistics::miss_rate() const
+{
+    return audited == 0 ? 0. : static_cast<double>(misses) / static_cast<double>(audited);
+}
+
+double SurrogateStatistics::speedup() const
+{
+    const auto seconds = partial_seconds + full_seconds;
+    if (evaluated == 0 || seconds <= 0)
+    {
+        return 1.;
+    }
+    const auto average_full = full_seconds / static_cast<double>(evaluated);
+    return static_cast<double>(candidates) * average_full / seconds;
+}
+
+void SurrogateStatistics::merge(const SurrogateStatistics &other)
+{
+    candidates += other.candidates;
+    skipped += other.skipped;
+    audited += other.audited;
+    misses += other.misses;
+    evaluated += other.evaluated;
+    partial_seconds += other.partial_seconds;
+    full_seconds += other.full_seconds;
+}
+
+Surrogate::Surrogate(SurrogateOptions options) : m_options(options) {}
+
+double Surrogate::predict(const std::vector<float> &features) const
+{
+    double prediction = 0;
+    for (std::size_t i = 0; i < m_weights.size() && i < features.size(); i++)
+    {
+        prediction += m_weights[i] * features[i];
+    }
+    return prediction;
+}
+
+void Surrogate::learn(const std::vector<float> &features, double distance_terms)
+{
+    const auto n = features.size();
+    if (m_weights.size() != n)
+    {
+        m_weights.assign(n, 0.);
+        m_inverse.assign(n * n, 0.);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            m_inverse[i * n + i] = initial_inverse;
+        }
+    }
+
+    // The weights can't be pinned down by fewer evaluations than there are features, so the
+    // errors before then say nothing about how good the model is
+    const auto error = distance_terms - predict(features);
+    if (m_observations >= n)
+    {
+        const auto smoothing =
+            std::max(1. / static_cast<double>(m_observations + 1 - n), error_smoothing);
+        m_error_variance += smoothing * (error * error - m_error_variance);
+    }
+    m_observations++;
+
+    // The standard recursive least squares update, with the gain worked out from the inverse
+    // before it's updated
+    std::vector<double> gain(n, 0.);
+    double denominator = m_options.forgetting;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        for (std::size_t j = 0; j < n; j++)
+        {
+            gain[i] += m_inverse[i * n + j] * features[j];
+        }
+        denominator += features[i] * gain[i];
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        m_weights[i] += gain[i] / denominator * error;
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        for (std::size_t j = 0; j < n; j++)
+        {
+            m_inverse[i * n + j] =
+                (m_inverse[i * n + j] - gain[i] * gain[j] / denominator) / m_options.forgetting;
+        }
+    }
+}
+
+Screening Surrogate::screen(const Map &map, const EvaluationTables &tables, float bound)
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_pending = evaluate_partial(map, tables);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    m_statistics.partial_seconds += elapsed.count();
+    m_statistics.candidates++;
+    m_pending_bound = bound;
+    m_pending_screening = Screening::evaluate;
+
+    if (m_observations < m_options.warmup)
+    {
+        return m_pending_screening;
+    }
+    const auto optimistic = m_pending.score + predict(m_pending.features) +
+                            m_options.margin * std::sqrt(m_error_variance);
+    if (optimistic <= bound)
+    {
+        m_would_skip++;
+        if (m_options.audit_every > 0 && m_would_skip % m_options.audit_every == 0)
+        {
+            m_pending_screening = Screening::audit;
+            m_statistics.audited++;
+        }
+        else
+        {
+            m_pending_screening = Screening::skip;
+            m_statistics.skipped++;
+        }
+    }
+    return m_pending_screening;
+}
+
+void Surrogate::record(float score, double seconds)
+{
+    if (m_pending_screening == Screening::skip)
+    {
+        return;
+    }
+    m_statistics.evaluated++;
+    m_statistics.full_seconds += seconds;
+    if (m_pending_screening == Screening::audit && score > m_pending_bound)
+    {
+        m_statistics.misses++;
+    }
+    learn(m_pending.features, static_cast<double>(score) - m_pending.score);
+}
+
+TEST_CASE("Surrogate")
+{
+    SUBCASE("Fits a linear function of the features")
+    {
+        Surrogate surrogate;
+        for (int i = 0; i < 200; i++)
+        {
+            const auto a = static_cast<float>(i % 7);
+            const auto b = static_cast<float>((i * 13) % 11);
+            surrogate.learn({1.f, a, b}, 2. + 3. * a - 0.5 * b);
+        }
+
+        CHECK(surrogate.predict({1.f, 4.f, 9.f}) == doctest::Approx(9.5).epsilon(1e-4));
+        CHECK(surrogate.predict({1.f, 0.f, 0.f}) == doctest::Approx(2.).epsilon(1e-4));
+    }
+
+    SUBCASE("Skips hopeless candidates after the warmup, auditing some of them")
+    {
+        const auto config = read_config_from_file("config.yml");
+        const EvaluationTables tables(config);
+        Rng rng(5);
+        const auto map =
+            GenomeTraits<std::vector<Node>>::rasterize(generate_random_tree(config, rng));
+        const auto score = evaluate(map, tables);
+        Surrogate surrogate({40, 3, 2, 0.9995});
+
+        std::vector<Screening> screenings;
+        for (int i = 0; i < 44; i++)
+        {
+            screenings.push_back(surrogate.screen(map, tables, score + 100.f));
+            surrogate.record(score, 0.);
+        }
+        CHECK(std::count(screenings.begin(), screenings.begin() + 40, Screening::evaluate) == 40);
+        CHECK(screenings[40] == Screening::skip);
+        CHECK(screenings[41] == Screening::audit);
+        CHECK(surrogate.statistics().skipped == 2);
+        CHECK(surrogate.statistics().audited == 2);
+        CHECK(surrogate.statistics().misses == 0);
+        CHECK(surrogate.statistics().evaluated == 42);
+
+        // Anything that can be accepted is always evaluated
+        CHECK(surrogate.screen(map, tables, -std::numeric_limits<float>::infinity()) ==
+              Screening::evaluate);
+    }
+
+    SUBCASE("Reports misses and the realised speedup")
+    {
+        SurrogateStatistics statistics;
+        statistics.candidates = 10;
+        statistics.skipped = 6;
+        statistics.audited = 2;
+        statistics.misses = 1;
+        statistics.evaluated = 4;
+        statistics.partial_seconds = 1;
+        statistics.full_seconds = 4;
+        auto total = statistics;
+        total.merge(statistics);
+
+        CHECK(statistics.miss_rate() == 0.5);
+        // Ten full evaluations at a second each, against five seconds spent
+        CHECK(statistics.speedup() == 2.);
+        CHECK(total.candidates == 20);
+        CHECK(total.speedup() == 2.);
+        CHECK(SurrogateStatistics().speedup() == 1.);
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "evaluate.hpp"
+#include "map.hpp"
+
+namespace rlo
+{
+struct SurrogateOptions
+{
+    // Full evaluations to learn from before any candidate is skipped
+    unsigned int warmup = 200;
+    // How many standard deviations of the prediction error a candidate's predicted score must
+    // fall short of acceptance by to be skipped
+    double margin = 3;
+    // Every this many candidates that would be skipped one is evaluated anyway, to measure how
+    // often skipping throws away a proposal that would have been accepted
+    unsigned int audit_every = 20;
+    // Below 1, older evaluations count for less, so the model follows the chain as it moves on
+    double forgetting = 0.9995;
+};
+
+struct SurrogateStatistics
+{
+    std::size_t candidates = 0;
+    std::size_t skipped = 0;
+    // Candidates that would have been skipped but were evaluated anyway, and how many of those
+    // turned out to be acceptable
+    std::size_t audited = 0;
+    std::size_t misses = 0;
+    std::size_t evaluated = 0;
+    double partial_seconds = 0;
+    double full_seconds = 0;
+
+    // The fraction of audited skips that would have been accepted
+    double miss_rate() const;
+    // How much faster screening scored the candidates than fully evaluating every one of them
+    // would have, assuming the skipped ones took as long as the average full evaluation
+    double speedup() const;
+    void merge(const SurrogateStatistics &other);
+};
+
+enum class Screening
+{
+    evaluate,
+    skip,
+    // Would have been skipped, but is being evaluated to check the model
+    audit
+};
+
+// Screens one chain's candidates before their full evaluations. A partial evaluation scores
+// everything but the distances between rooms, and a linear model fitted online by recursive least
+// squares predicts those distances from the partial evaluation's features. Candidates whose
+// predicted score falls well short of acceptance are skipped, saving their distance searches.
+// Decisions never draw from a random stream, so seeded runs stay reproducible.
+class Surrogate
+{
+  private:
+    SurrogateOptions m_options;
+    std::vector<double> m_weights;
+    // The inverse of the weighted feature covariance, row by row
+    std::vector<double> m_inverse;
+    // A moving average of the squared error of each prediction made before learning from it
+    double m_error_variance = 0;
+    std::size_t m_observations = 0;
+    std::size_t m_would_skip = 0;
+    // What the last candidate screened is waiting to be learnt against
+    PartialEvaluation m_pending;
+    Screening m_pending_screening = Screening::evaluate;
+    float m_pending_bound = 0;
+    SurrogateStatistics m_statistics;
+
+  public:
+    explicit Surrogate(SurrogateOptions options = {});
+
+    // The predicted distance terms of a partial evaluation, 0 until something has been learnt
+    double predict(const std::vector<float> &features) const;
+    void learn(const std::vector<float> &features, double distance_terms);
+
+    // Decides whether the map is worth a full evaluation, given that it needs to score above
+    // `bound` to be accepted
+    Screening screen(const Map &map, const EvaluationTables &tables, float bound);
+    // Learns from the full evaluation of the map last screened, unless it was skipped
+    void record(float score, double seconds);
+
+    inline const SurrogateStatistics &statistics() const { return m_statistics; }
+};
+}
\ No newline at end of file
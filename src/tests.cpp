@@ -0,0 +1,18 @@
+#include <vector>
+
+// rlo_tests runs every test case, taking doctest's command line options
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include "tests.hpp"
+#include "map.hpp"
+
+namespace rlo
+{
+std::vector<Room> sample_rooms()
+{
+    return {Room{0, 5, 5, 8, 6, {true, false, false, false}, {3, 0, 0, 0}, {0, 0, 0, 0}, {}},
+            Room{1, 20, 5, 7, 7, {true, true, false, false}, {0, 3, 0, 0}, {3, 6, 0, 0}, {}},
+            Room{2, 5, 30, 12, 5, {false, false, true, false}, {0, 0, 6, 0}, {0, 0, 4, 0}, {}}};
+}
+}
\ No newline at end of file
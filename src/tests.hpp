@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+#include "map.hpp"
+
+// Helpers shared by the test cases, which rlo_tests compiles in and the library leaves out
+namespace rlo
+{
+// Three small rooms of types 0, 1 and 2 with doors and windows, well apart in the top left of the
+// map, for tests that want a known layout rather than a random one
+std::vector<Room> sample_rooms();
+}
\ No newline at end of file
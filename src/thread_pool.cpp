@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include <doctest/doctest.h>
+
+#include "thread_pool.hpp"
+#include "topology.hpp"
+
+namespace rlo
+{
+ThreadPool::ThreadPool(unsigned int threads) : m_idle_workers(0), m_stopping(false)
+{
+    threads = std::max(threads, 1u);
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        m_workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_idle_workers++;
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            m_idle_workers--;
+            if (m_tasks.empty())
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t begin, std::size_t end,
+                              const std::function<void(std::size_t)> &body,
+                              unsigned int max_parallelism)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    // Shared with the helper tasks, which may only get to run after this call has returned
+    struct State
+    {
+        std::atomic<std::size_t> next;
+        std::size_t end;
+        const std::function<void(std::size_t)> *body;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::size_t completed = 0;
+        std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>();
+    state->next = begin;
+    state->end = end;
+    state->body = &body;
+
+    const auto run = [](State &state) {
+        std::size_t completed = 0;
+        std::size_t i;
+        while ((i = state.next++) < state.end)
+        {
+            try
+            {
+                (*state.body)(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (!state.exception)
+                {
+                    state.exception = std::current_exception();
+                }
+            }
+            completed++;
+        }
+        if (completed > 0)
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.completed += completed;
+            state.condition.notify_all();
+        }
+    };
+
+    const auto helpers = std::min({static_cast<std::size_t>(std::max(max_parallelism, 1u) - 1),
+                                   static_cast<std::size_t>(idle_workers()), end - begin - 1});
+    for (std::size_t i = 0; i < helpers; i++)
+    {
+        enqueue([state, run] { run(*state); });
+    }
+    run(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&] { return state->completed == end - begin; });
+    if (state->exception)
+    {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+unsigned int ThreadPool::place(const CpuTopology &topology, ThreadPlacement placement)
+{
+    const auto plan = plan_placement(allowed_cpus_only(topology), size() + 1, placement);
+    if (plan.empty())
+    {
+        return 0;
+    }
+    unsigned int bound = bind_thread(pthread_self(), plan[0]) ? 1 : 0;
+    for (std::size_t i = 0; i < m_workers.size(); i++)
+    {
+        bound += bind_thread(m_workers[i].native_handle(), plan[i + 1]) ? 1 : 0;
+    }
+    return bound;
+}
+
+TEST_CASE("ThreadPool")
+{
+    ThreadPool pool(4);
+
+    SUBCASE("submit() returns the task's result")
+    {
+        auto future = pool.submit([] { return 42; });
+
+        CHECK(future.get() == 42);
+    }
+
+    SUBCASE("parallel_for() visits every index exactly once")
+    {
+        std::vector<std::atomic<int>> visits(1000);
+        pool.parallel_for(
+            0, visits.size(), [&](std::size_t i) { visits[i]++; }, 4);
+
+        CHECK(std::all_of(visits.begin(), visits.end(),
+                          [](const std::atomic<int> &count) { return count == 1; }));
+    }
+
+    SUBCASE("Nested parallel_for() calls from every worker complete")
+    {
+        std::atomic<int> total(0);
+        pool.parallel_for(
+            0, 8,
+            [&](std::size_t) {
+                pool.parallel_for(
+                    0, 100, [&](std::size_t) { total++; }, 4);
+            },
+            8);
+
+        CHECK(total == 800);
+    }
+
+    SUBCASE("place() binds every thread to a CPU the process may use")
+    {
+        ThreadPool placed(2);
+        const auto topology = read_cpu_topology();
+        std::vector<unsigned int> allowed;
+        for (const auto &node : allowed_cpus_only(topology).nodes)
+        {
+            allowed.insert(allowed.end(), node.cpus.begin(), node.cpus.end());
+        }
+        std::atomic<int> total(0);
+
+        CHECK(placed.place(topology, ThreadPlacement::none) == 0);
+        CHECK(placed.place(topology, ThreadPlacement::numa) == 3);
+        placed.parallel_for(
+            0, 100, [&](std::size_t) { total++; }, 3);
+        CHECK(total == 100);
+
+        // Undo the caller's binding so the rest of the tests run wherever they like
+        CHECK(bind_thread(pthread_self(), allowed));
+    }
+
+    SUBCASE("parallel_for() rethrows exceptions on the calling thread")
+    {
+        CHECK_THROWS(pool.parallel_for(
+            0, 10,
+            [](std::size_t i) {
+                if (i == 5)
+                {
+                    throw std::runtime_error("Failed");
+                }
+            },
+            4));
+    }
+}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "topology.hpp"
+
+namespace rlo
+{
+class ThreadPool
+{
+  private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<unsigned int> m_idle_workers;
+    bool m_stopping;
+
+    void enqueue(std::function<void()> task);
+    void work();
+
+  public:
+    explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Process-wide pool sized to the machine, shared by the optimizer and the evaluator
+    static ThreadPool &shared();
+
+    template <class Function>
+    auto submit(Function &&function) -> std::future<decltype(function())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(function())()>>(
+            std::forward<Function>(function));
+        auto future = task->get_future();
+        enqueue([task] { (*task)(); });
+        return future;
+    }
+
+    // Calls body(i) for every i in [begin, end) using at most max_parallelism threads, counting
+    // the caller. The caller always takes part and only borrows workers that are idle right
+    // now, so this is safe to call from inside a pool task: nested calls degrade to running
+    // serially on the calling thread rather than deadlocking or oversubscribing.
+    void parallel_for(std::size_t begin, std::size_t end,
+                      const std::function<void(std::size_t)> &body,
+                      unsigned int max_parallelism);
+
+    // Binds the calling thread, which takes part in the parallel_for() calls it makes, and then
+    // each worker to the CPUs plan_placement() deals them, out of the CPUs this process may use.
+    // Memory a bound thread allocates is first touched on its own node and stays local to it.
+    // The calling thread's own affinity decides which CPUs may be used, so call this once,
+    // before any work starts. Returns how many threads were bound.
+    unsigned int place(const CpuTopology &topology, ThreadPlacement placement);
+
+    inline unsigned int size() const { return static_cast<unsigned int>(m_workers.size()); }
+    inline unsigned int idle_workers() const { return m_idle_workers.load(); }
+};
+}
\ No newline at end of file
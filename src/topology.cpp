@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <doctest/doctest.h>
+
+#include "topology.hpp"
+
+namespace rlo
+{
+ThreadPlacement parse_thread_placement(const std::string &name)
+{
+    if (name == "none")
+    {
+        return ThreadPlacement::none;
+    }
+    if (name == "numa")
+    {
+        return ThreadPlacement::numa;
+    }
+    if (name == "cpu")
+    {
+        return ThreadPlacement::cpu;
+    }
+    throw std::runtime_error("Unknown thread placement: " + name);
+}
+
+std::vector<unsigned int> parse_cpu_list(const std::string &list)
+{
+    std::vector<unsigned int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        range.erase(std::remove_if(range.begin(), range.end(),
+                                   [](char c) { return c == ' ' || c == '\n'; }),
+                    range.end());
+        if (range.empty())
+        {
+            continue;
+        }
+        const auto dash = range.find('-');
+        const auto first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+        const auto last = dash == std::string::npos
+                              ? first
+                              : static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+        for (auto cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::string read_first_line(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+CpuTopology read_cpu_topology(const std::string &root)
+{
+    CpuTopology topology;
+    const auto node_directory = std::filesystem::path(root) / "devices/system/node";
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(node_directory, error))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            continue;
+        }
+        auto cpus = parse_cpu_list(read_first_line(entry.path() / "cpulist"));
+        if (!cpus.empty())
+        {
+            topology.nodes.push_back(
+                {static_cast<unsigned int>(std::stoul(name.substr(4))), std::move(cpus)});
+        }
+    }
+    std::sort(topology.nodes.begin(), topology.nodes.end(),
+              [](const NumaNode &lhs, const NumaNode &rhs) { return lhs.id < rhs.id; });
+
+    if (topology.nodes.empty())
+    {
+        auto cpus = parse_cpu_list(
+            read_first_line(std::filesystem::path(root) / "devices/system/cpu/online"));
+        if (cpus.empty())
+        {
+            for (unsigned int cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u);
+                 cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        topology.nodes.push_back({0, std::move(cpus)});
+    }
+    return topology;
+}
+
+CpuTopology allowed_cpus_only(const CpuTopology &topology)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return topology;
+    }
+    CpuTopology result;
+    for (const auto &node : topology.nodes)
+    {
+        NumaNode kept{node.id, {}};
+        std::copy_if(
+            node.cpus.begin(), node.cpus.end(), std::back_inserter(kept.cpus),
+            [&](unsigned int cpu) { return cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed); });
+        if (!kept.cpus.empty())
+        {
+            result.nodes.push_back(std::move(kept));
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<unsigned int>> plan_placement(const CpuTopology &topology,
+                                                      unsigned int threads,
+                                                      ThreadPlacement placement)
+{
+    std::vector<std::vector<unsigned int>> plan;
+    std::vector<const NumaNode *> cpu_nodes;
+    std::vector<unsigned int> cpus;
+    for (const auto &node : topology.nodes)
+    {
+        for (const auto cpu : node.cpus)
+        {
+            cpu_nodes.push_back(&node);
+            cpus.push_back(cpu);
+        }
+    }
+    if (placement == ThreadPlacement::none || cpus.empty())
+    {
+        return plan;
+    }
+    for (unsigned int thread = 0; thread < threads; thread++)
+    {
+        const auto slot = thread % cpus.size();
+        if (placement == ThreadPlacement::numa)
+        {
+            plan.push_back(cpu_nodes[slot]->cpus);
+        }
+        else
+        {
+            plan.push_back({cpus[slot]});
+        }
+    }
+    return plan;
+}
+
+bool bind_thread(std::thread::native_handle_type thread, const std::vector<unsigned int> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+TEST_CASE("CPU topology")
+{
+    SUBCASE("parse_cpu_list() expands ranges")
+    {
+        CHECK(parse_cpu_list("0-3,8,10-11\n") ==
+              std::vector<unsigned int>{0, 1, 2, 3, 8, 10, 11});
+        CHECK(parse_cpu_list("").empty());
+    }
+
+    SUBCASE("read_cpu_topology() reads every node directory")
+    {
+        const auto root = std::filesystem::temp_directory_path() / "rlo_topology_test";
+        std::filesystem::create_directories(root / "devices/system/node/node0");
+        std::filesystem::create_directories(root / "devices/system/node/node1");
+        std::filesystem::create_directories(root / "devices/system/node/possible_not_a_node");
+        std::ofstream(root / "devices/system/node/node1/cpulist") << "4-7\n";
+        std::ofstream(root / "devices/system/node/node0/cpulist") << "0-3\n";
+        const auto topology = read_cpu_topology(root.string());
+        std::filesystem::remove_all(root);
+
+        REQUIRE(topology.nodes.size() == 2);
+        CHECK(topology.nodes[0].id == 0);
+        CHECK(topology.nodes[1].cpus == std::vector<unsigned int>{4, 5, 6, 7});
+    }
+
+    SUBCASE("read_cpu_topology() falls back to one node of the online CPUs")
+    {
+        const auto root = std::filesystem::temp_directory_path() / "rlo_topology_test";
+        std::filesystem::create_directories(root / "devices/system/cpu");
+        std::ofstream(root / "devices/system/cpu/online") << "0-1\n";
+        const auto topology = read_cpu_topology(root.string());
+        std::filesystem::remove_all(root);
+
+        REQUIRE(topology.nodes.size() == 1);
+        CHECK(topology.nodes[0].cpus == std::vector<unsigned int>{0, 1});
+    }
+
+    SUBCASE("plan_placement() fills one node before the next")
+    {
+        const CpuTopology topology{{{0, {0, 1}}, {1, {2, 3}}}};
+
+        CHECK(plan_placement(topology, 3, ThreadPlacement::none).empty());
+        CHECK(plan_placement(topology, 5, ThreadPlacement::cpu) ==
+              std::vector<std::vector<unsigned int>>{{0}, {1}, {2}, {3}, {0}});
+        CHECK(plan_placement(topology, 3, ThreadPlacement::numa) ==
+              std::vector<std::vector<unsigned int>>{{0, 1}, {0, 1}, {2, 3}});
+    }
+}
+}
\ No newline at end of file
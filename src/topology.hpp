@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rlo
+{
+// How pool threads are bound to CPUs. With numa each thread may run anywhere on one NUMA node,
+// so the memory it first touches stays on that node; with cpu each thread gets a CPU to itself.
+enum class ThreadPlacement
+{
+    none,
+    numa,
+    cpu
+};
+
+ThreadPlacement parse_thread_placement(const std::string &name);
+
+struct NumaNode
+{
+    unsigned int id;
+    std::vector<unsigned int> cpus;
+};
+
+struct CpuTopology
+{
+    std::vector<NumaNode> nodes;
+};
+
+// Parses the kernel's CPU list format, like "0-3,8,10-11"
+std::vector<unsigned int> parse_cpu_list(const std::string &list);
+
+// Reads the NUMA nodes and their CPUs from sysfs under `root`. Machines or containers without
+// node directories come back as a single node holding every online CPU.
+CpuTopology read_cpu_topology(const std::string &root = "/sys");
+
+// Drops the CPUs this process isn't allowed to run on, and any nodes left empty
+CpuTopology allowed_cpus_only(const CpuTopology &topology);
+
+// The CPUs each of `threads` threads should be bound to. Threads are dealt out one CPU at a time,
+// filling a node before moving on to the next, and wrap around when there are more threads than
+// CPUs. Empty when placement is none.
+std::vector<std::vector<unsigned int>> plan_placement(const CpuTopology &topology,
+                                                      unsigned int threads,
+                                                      ThreadPlacement placement);
+
+// Returns false if the OS refuses, leaving the thread where it was
+bool bind_thread(std::thread::native_handle_type thread, const std::vector<unsigned int> &cpus);
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "verify.hpp"
+#include "config.hpp"
+#include "evaluate.hpp"
+#include "map.hpp"
+#include "optimize.hpp"
+#include "reference.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+namespace rlo
+{
+VerificationResult verify_evaluation(const std::vector<RoomConfig> &config,
+                                     const VerificationOptions &options)
+{
+    auto &pool = ThreadPool::shared();
+    const EvaluationParallelism parallelism{&pool, options.evaluation_threads};
+    const EvaluationTables tables(config);
+    Rng rng(options.seed == 0 ? random_seed() : options.seed);
+
+    VerificationResult result{0, 0.f, 0., 0., {}};
+    for (unsigned int layout = 0; layout < options.layouts; layout++)
+    {
+        auto nodes = generate_random_tree(config, rng);
+        for (unsigned int mutation = 0; mutation <= options.mutations; mutation++)
+        {
+            if (mutation > 0)
+            {
+                nodes = permute(nodes, config, rng);
+            }
+            const Map map(map_size, nodes);
+
+            const auto fast_start = std::chrono::steady_clock::now();
+            const auto fast = evaluate(map, tables, parallelism);
+            const auto reference_start = std::chrono::steady_clock::now();
+            const auto reference = reference_evaluate(map, config);
+            const auto reference_end = std::chrono::steady_clock::now();
+            result.fast_seconds +=
+                std::chrono::duration<double>(reference_start - fast_start).count();
+            result.reference_seconds +=
+                std::chrono::duration<double>(reference_end - reference_start).count();
+
+            // NaNs compare unequal to everything, so they count as diverging too
+            const auto difference = std::abs(fast - reference);
+            const auto allowed =
+                options.tolerance + options.relative_tolerance * std::abs(reference);
+            result.samples++;
+            result.max_difference = std::max(result.max_difference, difference);
+            if (!(difference <= allowed))
+            {
+                result.first_divergence = Divergence{result.samples - 1, fast, reference, nodes};
+                return result;
+            }
+        }
+    }
+    return result;
+}
+
+TEST_CASE("verify_evaluation()")
+{
+    const auto config = read_config_from_file("config.yml");
+    VerificationOptions options;
+    options.layouts = 3;
+    options.mutations = 3;
+    options.seed = 11;
+    options.evaluation_threads = 2;
+
+    SUBCASE("The fast evaluator matches the reference exactly")
+    {
+        const auto result = verify_evaluation(config, options);
+
+        CHECK(!result.first_divergence);
+        CHECK(result.samples == 12);
+        CHECK(result.max_difference == 0.f);
+    }
+
+    SUBCASE("Reports the first sample outside a negative tolerance")
+    {
+        options.tolerance = -1.f;
+        const auto result = verify_evaluation(config, options);
+
+        REQUIRE(result.first_divergence);
+        CHECK(result.first_divergence->sample == 0);
+        CHECK(result.samples == 1);
+    }
+}
+}
\ No newline at end of file
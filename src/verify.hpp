@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "config.hpp"
+#include "map.hpp"
+
+namespace rlo
+{
+struct VerificationOptions
+{
+    // Random trees to start from, and how many mutated layouts to score along from each one
+    unsigned int layouts = 20;
+    unsigned int mutations = 10;
+    // Scores differing by more than tolerance + relative_tolerance * |reference| diverge
+    float tolerance = 0.f;
+    float relative_tolerance = 0.f;
+    // 0 picks a random seed
+    std::uint64_t seed = 0;
+    // Threads the fast path may use for its per-room searches, so the parallel path is checked
+    unsigned int evaluation_threads = 1;
+};
+
+struct Divergence
+{
+    std::size_t sample;
+    float fast;
+    float reference;
+    std::vector<Node> layout;
+};
+
+struct VerificationResult
+{
+    std::size_t samples;
+    float max_difference;
+    double fast_seconds;
+    double reference_seconds;
+    std::optional<Divergence> first_divergence;
+};
+
+// Scores trees from generate_random_tree(), and chains of permute() mutations of them, with both
+// evaluate() and reference_evaluate(), stopping at the first pair of scores that diverge
+VerificationResult verify_evaluation(const std::vector<RoomConfig> &config,
+                                     const VerificationOptions &options = {});
+}
\ No newline at end of file